@@ -0,0 +1,58 @@
+// 连接缓冲区：可增长的字节缓冲
+#ifndef BUFFER_H
+#define BUFFER_H
+
+#include <stddef.h>
+
+// 首次使用时分配的容量，这个大小的内存块由线程内的缓冲池复用
+#define BUFFER_INIT_SIZE 1024
+// 每个线程缓冲池最多缓存的空闲块数，超出的直接还给系统
+#define BUFFER_POOL_MAX 4096
+// 单个缓冲区的容量上限，超过视为异常请求
+#define BUFFER_MAX_SIZE (64 * 1024 * 1024)
+
+// 缓冲区只在有数据要读写时才挂上内存，一轮收发结束后调用 buffer_shrink 归还，
+// 百万空闲连接只占 buffer_t 本身的几十字节；BUFFER_INIT_SIZE 大小的块从线程内缓冲池获取，
+// 池里的块只被同一个 reactor 线程使用，不需要加锁
+// 有效数据位于 data[head, tail)，读走的数据只移动 head，写入追加到 tail
+// 空间不足时先把有效数据挪回开头，仍不够再按 2 倍扩容
+// 只要分配过内存，data[tail] 始终为 '\0'，协议代码可以直接把可读区当字符串处理
+typedef struct buffer_s {
+    char *data;
+    int cap;    // 不含结尾 '\0' 的容量
+    int head;
+    int tail;
+} buffer_t;
+
+// 初始化为空缓冲（不分配内存）
+void buffer_init(buffer_t *b);
+// 释放内存并回到空缓冲状态
+void buffer_free(buffer_t *b);
+
+// 保证至少有 n 字节可写空间，失败返回 -1
+int buffer_reserve(buffer_t *b, int n);
+// 追加数据，返回追加的字节数，失败返回 -1
+int buffer_append(buffer_t *b, const void *data, int len);
+// 格式化追加，返回追加的字节数，失败返回 -1
+int buffer_printf(buffer_t *b, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+// 直接写入 buffer_write_ptr 之后确认写入的字节数
+void buffer_commit(buffer_t *b, int n);
+// 丢弃开头 n 字节已处理的数据
+void buffer_consume(buffer_t *b, int n);
+// 清空数据（保留内存）
+void buffer_clear(buffer_t *b);
+// 数据为空时释放内存，连接空闲期间不持有任何缓冲区
+void buffer_shrink(buffer_t *b);
+
+// 从 fd 读一次数据追加到缓冲区，返回值同 read
+// 可写空间不够时借用栈上的临时空间，一次读取不受当前容量限制
+int buffer_read_fd(buffer_t *b, int fd);
+
+// 可读数据
+static inline char *buffer_peek(const buffer_t *b) { return b->data + b->head; }
+static inline int buffer_len(const buffer_t *b) { return b->tail - b->head; }
+// 可写区域
+static inline char *buffer_write_ptr(const buffer_t *b) { return b->data + b->tail; }
+static inline int buffer_writable(const buffer_t *b) { return b->cap - b->tail; }
+
+#endif // BUFFER_H
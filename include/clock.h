@@ -0,0 +1,49 @@
+// 缓存时钟：reactor 每轮事件循环醒来后刷新一次，之后同一轮里的日志、统计和超时计算都直接读缓存，
+// 热路径上不再调用 libc 的时间函数
+// 缓存按线程保存；没有调用过 clock_update 的线程（主线程启动阶段、日志后台线程等）每次读取都现取时间
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <time.h>
+
+struct clock_cache {
+    long long mono_ms;      // 单调时钟（毫秒），用于超时和定时器
+    long long wall_ms;      // 墙上时间（Unix 毫秒），用于 TTL 等需要绝对时间的场景
+    time_t wall_sec;
+    time_t str_sec;         // timestr 对应的秒，秒数变化时才重新格式化
+    char timestr[16];       // 本地时间 "HH:MM:SS"，供日志使用
+    int driven;             // 是否由事件循环刷新
+};
+
+extern __thread struct clock_cache clock_tls;
+
+// 重新读取时间，刷新当前线程的缓存
+void clock_refresh(void);
+
+// 事件循环每轮调用一次：刷新缓存，并把当前线程标记为由事件循环驱动
+static inline void clock_update(void) {
+    clock_tls.driven = 1;
+    clock_refresh();
+}
+
+static inline long long clock_mono_ms(void) {
+    if (!clock_tls.driven) clock_refresh();
+    return clock_tls.mono_ms;
+}
+
+static inline long long clock_wall_ms(void) {
+    if (!clock_tls.driven) clock_refresh();
+    return clock_tls.wall_ms;
+}
+
+static inline time_t clock_wall_sec(void) {
+    if (!clock_tls.driven) clock_refresh();
+    return clock_tls.wall_sec;
+}
+
+static inline const char *clock_timestr(void) {
+    if (!clock_tls.driven) clock_refresh();
+    return clock_tls.timestr;
+}
+
+#endif // CLOCK_H
@@ -2,15 +2,40 @@
 #define _HASH_H_
 
 #include "kvstore.h"
-#include <pthread.h> // 因为 hashtable_t 结构体中包含了 pthread_mutex_t
+#include <pthread.h> // 因为 hash_shard_t 结构体中包含了 pthread_rwlock_t
 
 // --- 公共宏定义 ---
-// 用户会需要这些宏来定义自己的键和值缓冲区
+// 键的长度上限（含结尾的 '\0'）；值按实际长度存放，只受内存限制（长度需小于 4GB）
 #define MAX_KEY_LEN   128
-#define MAX_VALUE_LEN 512
 
 // --- 公共数据结构 ---
 
+// 分片数上限（2 的幂），分片由哈希值的最高几位选择，和桶下标用的低位互不相关
+#define HASH_MAX_SHARDS 256
+
+/**
+ * @brief 哈希表的一个分片：独立的桶数组、键数和读写锁，各分片之间互不影响。
+ * 按缓存行对齐，不同线程访问相邻分片时不会因为锁和计数落在同一缓存行而互相干扰。
+ */
+typedef struct hash_shard_s {
+    void *nodes;             // 当前桶数组（连同槽位数一起分配，隐藏内部结构）
+
+    int max_slots;           // 本分片的槽位数（只读）
+    int min_slots;           // 初始槽位数，也是缩容的下限
+    int count;               // 本分片存储的键值对数量（只读）
+
+    // 渐进式 rehash：扩容/缩容时新建一张表，每次操作顺带迁移几个桶，迁移完成后替换旧表
+    void *rehash_nodes;      // 新表，未在 rehash 时为 NULL
+    int rehash_idx;          // 旧表中下一个待迁移的桶，未在 rehash 时为 -1
+    void *retired_nodes;     // 迁移完成的旧桶数组，解锁之后交给 QSBR 延迟释放
+
+    // 顺序计数：迁移桶和替换表期间为奇数，无锁读者据此判断未命中是否可信
+    unsigned seq;
+
+    // 读写锁：修改和 rehash 迁移加写锁；已登记 QSBR 的线程查询不加锁，其他线程查询加读锁
+    pthread_rwlock_t lock;
+} __attribute__((aligned(64))) hash_shard_t;
+
 /**
  * @brief 哈希表的主结构体。
  * 使用者应该将此类型的变量传递给哈希表函数进行操作。
@@ -18,13 +43,9 @@
  * 除非你知道你在做什么。
  */
 typedef struct hashtable_s {
-    void **nodes;           // 使用 void** 来隐藏内部节点细节
-
-    int max_slots;           // 哈希表的总槽位数（只读）
-    int count;               // 当前存储的键值对数量（只读）
-
-    pthread_mutex_t lock;    // 线程安全锁
-    
+    hash_shard_t *shards;    // 分片数组，kvs_hash_create 时分配
+    int shard_count;         // 分片数，2 的幂（只读）
+    int shard_bits;          // log2(shard_count)
 } hashtable_t;
 
 // --- 函数声明已移至 kvstore.h ---
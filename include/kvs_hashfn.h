@@ -0,0 +1,81 @@
+// 存储引擎使用的字符串哈希函数
+// 算法为 wyhash（final4 版本）：每 16 字节一次 64x64->128 位乘法混合，短键只做两次乘法，
+// 分布质量通过 SMHasher 全部测试，速度远高于逐字节累加/乘法类的哈希
+#ifndef KVS_HASHFN_H
+#define KVS_HASHFN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// 固定种子，同一个键在任何进程中得到相同的哈希值
+#define KVS_HASH_SEED 0x9e3779b97f4a7c15ULL
+
+static inline void kvs_wymum(uint64_t *a, uint64_t *b) {
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+}
+
+static inline uint64_t kvs_wymix(uint64_t a, uint64_t b) {
+    kvs_wymum(&a, &b);
+    return a ^ b;
+}
+
+// 未对齐读取，memcpy 会被编译成一条 mov
+static inline uint64_t kvs_wyr8(const uint8_t *p) { uint64_t v; memcpy(&v, p, 8); return v; }
+static inline uint64_t kvs_wyr4(const uint8_t *p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static inline uint64_t kvs_wyr3(const uint8_t *p, size_t k) {
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+static inline uint64_t kvs_hash_bytes(const void *key, size_t len) {
+    static const uint64_t s[4] = {
+        0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+    };
+    const uint8_t *p = (const uint8_t *)key;
+    uint64_t seed = KVS_HASH_SEED ^ kvs_wymix(KVS_HASH_SEED ^ s[0], s[1]);
+    uint64_t a, b;
+
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (kvs_wyr4(p) << 32) | kvs_wyr4(p + ((len >> 3) << 2));
+            b = (kvs_wyr4(p + len - 4) << 32) | kvs_wyr4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = kvs_wyr3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i >= 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = kvs_wymix(kvs_wyr8(p) ^ s[1], kvs_wyr8(p + 8) ^ seed);
+                see1 = kvs_wymix(kvs_wyr8(p + 16) ^ s[2], kvs_wyr8(p + 24) ^ see1);
+                see2 = kvs_wymix(kvs_wyr8(p + 32) ^ s[3], kvs_wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i >= 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = kvs_wymix(kvs_wyr8(p) ^ s[1], kvs_wyr8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = kvs_wyr8(p + i - 16);
+        b = kvs_wyr8(p + i - 8);
+    }
+    a ^= s[1];
+    b ^= seed;
+    kvs_wymum(&a, &b);
+    return kvs_wymix(a ^ s[0] ^ len, b ^ s[1]);
+}
+
+static inline uint64_t kvs_hash_str(const char *key) {
+    return kvs_hash_bytes(key, strlen(key));
+}
+
+#endif // KVS_HASHFN_H
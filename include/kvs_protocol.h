@@ -1,6 +1,8 @@
 #ifndef __KVS_PROTOCOL_H__
 #define __KVS_PROTOCOL_H__
 
+#include "buffer.h"
+
 // 命令枚举定义
 enum {
 	KVS_CMD_START = 0,
@@ -22,18 +24,29 @@ enum {
 	KVS_CMD_HDEL,
 	KVS_CMD_HMOD,
 	KVS_CMD_HEXIST,
+	KVS_CMD_HSCAN,      // 增量遍历键（只支持拉链引擎）
+	// 服务器信息（由 kvs_handler 处理，不经过存储引擎执行器）
+	KVS_CMD_INFO,
+	KVS_CMD_STATS,      // INFO 的别名
+	KVS_CMD_LOGLEVEL,   // 查看/调整运行时日志级别
 	
 	KVS_CMD_COUNT,
 };
 
-// 分词器 - 将字符串按空格分割成多个token
+// 单条命令最多解析的 token 数，tokens 数组至少要有这么大
+#define KVS_MAX_TOKENS 8
+
+// 分词器 - 将字符串按空格分割成多个token，超过 KVS_MAX_TOKENS 的部分忽略
 int kvs_tokenizer(char* msg, char** tokens);
 
 // 命令识别器 - 识别命令并返回命令索引
 int kvs_parser_command(char** tokens);
 
-// 命令执行器 - 执行命令并生成响应
-int kvs_executor_command(int cmd, char** tokens, char* response);
+// 命令名，编号无效时返回 NULL
+const char *kvs_command_name(int cmd);
+
+// 命令执行器 - 执行命令并把响应追加到 response（不含 CRLF）
+int kvs_executor_command(int cmd, char** tokens, buffer_t* response);
 
 #endif
 
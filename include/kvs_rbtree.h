@@ -28,6 +28,7 @@ typedef struct rbtree_node_s {
 typedef struct rbtree_s {
     rbtree_node *root;    // 根节点
     rbtree_node *nil;     // 哨兵节点（代表所有叶子节点）
+    int count;            // 节点数
 } rbtree;
 
 // 为了与其他模块命名统一
@@ -0,0 +1,29 @@
+#ifndef _SWISS_H_
+#define _SWISS_H_
+
+#include "kvstore.h"
+#include <stdint.h>
+#include <pthread.h>
+
+// 每组的槽位数：一次 SSE2 比较正好处理一组 16 个控制字节
+#define SWISS_GROUP_WIDTH 16
+
+/**
+ * @brief SwissTable 风格的开放寻址哈希表。
+ * 每个槽对应一个控制字节（空 / 已删除 / 哈希值低 7 位），查找时先按组比较控制字节，
+ * 只有控制字节匹配的槽才去读键；槽里只放哈希值和键、值指针，键值本身在表外单独分配。
+ * 扩容/缩容一次性重建整张表（均摊 O(1)），需要平滑延迟时使用拉链哈希表（kvs_hash.c）。
+ * 和 hashtable_t 一样，请不要直接访问内部成员。
+ */
+typedef struct swisstable_s {
+    int8_t *ctrl;            // 控制字节数组，capacity 个
+    void *slots;             // 槽数组，隐藏内部结构
+
+    int capacity;            // 槽位数，SWISS_GROUP_WIDTH 乘以 2 的幂（只读）
+    int count;               // 当前存储的键值对数量（只读）
+    int growth_left;         // 在需要重建之前还能占用的空槽数，删除留下的墓碑同样占用
+
+    pthread_mutex_t lock;    // 线程安全锁
+} swisstable_t;
+
+#endif // _SWISS_H_
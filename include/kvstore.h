@@ -19,6 +19,7 @@
 #define KVS_IS_ARRAY    1   // 数组
 #define KVS_IS_RBTREE   1   // 红黑树
 #define KVS_IS_HASH     1   // 哈希表
+#define KVS_IS_SWISS    1   // SwissTable 开放寻址哈希表（HSET 系列命令的可选引擎）
 
 // ========== 错误码定义 ==========
 #define KVS_OK              0   // 成功
@@ -55,6 +56,9 @@ extern kvs_array_t* global_array;
 // 内存管理函数
 void kvs_free(void* ptr);
 void* kvs_malloc(size_t size);
+void* kvs_calloc(size_t n, size_t size);
+// 按 alignment 对齐分配（alignment 为 2 的幂且是指针大小的倍数），同样用 kvs_free 释放
+void* kvs_malloc_aligned(size_t alignment, size_t size);
 
 // 错误处理函数
 const char *kvs_strerror(int errnum);
@@ -67,6 +71,8 @@ int kvs_array_get(kvs_array_t* ins, char* key, char** value);
 int kvs_array_mod(kvs_array_t* ins, char* key, char* val);
 int kvs_array_del(kvs_array_t* ins, char* key);
 int kvs_array_exist(kvs_array_t* ins, char* key);
+// 统计接口：不加锁读取，只用于观察
+int kvs_array_boundary(kvs_array_t* ins);
 
 // ========== 红黑树相关类型和函数声明 (定义在 kvs_rbtree.c) ==========
 #if KVS_IS_RBTREE
@@ -85,6 +91,7 @@ int kvs_rbtree_get(kvs_rbtree_t *inst, char *key, char **value);
 int kvs_rbtree_mod(kvs_rbtree_t *inst, char *key, char *value);
 int kvs_rbtree_del(kvs_rbtree_t *inst, char *key);
 int kvs_rbtree_exist(kvs_rbtree_t *inst, char *key);
+int kvs_rbtree_count(kvs_rbtree_t *inst);
 
 #endif // KVS_IS_RBTREE
 
@@ -99,13 +106,54 @@ extern hashtable_t* global_hash;
 
 // 哈希表 KVS 操作函数（在 hash.h 中声明）
 int kvs_hash_create(hashtable_t *hash);
+// shards 为 2 的幂（1 ~ HASH_MAX_SHARDS），各分片独立加锁
+int kvs_hash_create_sharded(hashtable_t *hash, int shards);
 int kvs_hash_destroy(hashtable_t *hash);
 int kvs_hash_set(hashtable_t *hash, char *key, char *value);
 int kvs_hash_get(hashtable_t *hash, char *key, char **value);
 int kvs_hash_mod(hashtable_t *hash, char *key, char *value);
 int kvs_hash_del(hashtable_t *hash, char *key);
 int kvs_hash_exist(hashtable_t *hash, char *key);
+int kvs_hash_count(hashtable_t *hash);
+int kvs_hash_slots(hashtable_t *hash);
+int kvs_hash_shards(hashtable_t *hash);
+int kvs_hash_shard_count(hashtable_t *hash, int shard);
+// 遍历回调，key 只在回调期间有效（回调时持有分片锁，不能再调用哈希表接口）
+typedef void (*kvs_scan_fn)(const char *key, void *arg);
+// 增量遍历：从 cursor（首次为 0）开始访问约 count 个键，以 prefix 开头的（prefix 为 NULL 时全部）交给 fn，
+// *next 为下一次的游标，0 表示遍历完成；遍历期间一直存在的键至少返回一次（扩缩容时可能重复）
+int kvs_hash_scan(hashtable_t *hash, uint64_t cursor, int count, const char *prefix,
+                  kvs_scan_fn fn, void *arg, uint64_t *next);
 
 #endif // KVS_IS_HASH
 
+// ========== SwissTable 相关类型和函数声明 (定义在 kvs_swiss.c) ==========
+#if KVS_IS_SWISS
+
+// 前向声明
+typedef struct swisstable_s swisstable_t;
+
+// 全局变量声明
+extern swisstable_t* global_swiss;
+
+// SwissTable KVS 操作函数，语义和哈希表的同名函数相同
+int kvs_swiss_create(swisstable_t *t);
+int kvs_swiss_destroy(swisstable_t *t);
+int kvs_swiss_set(swisstable_t *t, char *key, char *value);
+int kvs_swiss_get(swisstable_t *t, char *key, char **value);
+int kvs_swiss_mod(swisstable_t *t, char *key, char *value);
+int kvs_swiss_del(swisstable_t *t, char *key);
+int kvs_swiss_exist(swisstable_t *t, char *key);
+int kvs_swiss_count(swisstable_t *t);
+int kvs_swiss_slots(swisstable_t *t);
+
+#endif // KVS_IS_SWISS
+
+// HSET/HGET/HDEL/HMOD/HEXIST 使用的引擎（定义在 kvs_base.c），启动时由 --hash-engine 选择
+#define KVS_HASH_ENGINE_CHAIN 0     // 拉链哈希表 + 渐进式 rehash（默认）
+#define KVS_HASH_ENGINE_SWISS 1     // SwissTable
+extern int kvs_hash_engine;
+// 拉链哈希表的分片数（定义在 kvs_base.c），启动时由 --hash-shards 选择，kvs_init 之前设置
+extern int kvs_hash_shards_opt;
+
 #endif
\ No newline at end of file
@@ -1,9 +1,8 @@
 #ifndef __LOGGER_H__
 #define __LOGGER_H__
 
-#include <stdio.h>
-#include <time.h>
-#include <string.h>
+#include "clock.h"
+#include <stdint.h>
 
 // 日志级别定义
 #define LOG_LEVEL_DEBUG   0
@@ -11,11 +10,16 @@
 #define LOG_LEVEL_WARN    2
 #define LOG_LEVEL_ERROR   3
 
-// 默认日志级别 (可以在编译时通过 -DLOG_LEVEL=x 修改)
+// 启动时的日志级别 (可以在编译时通过 -DLOG_LEVEL=x 修改)，运行中可以用 log_set_level 调整
 #ifndef LOG_LEVEL
 #define LOG_LEVEL LOG_LEVEL_ERROR
 #endif
 
+// 编译进程序的最低级别 (-DLOG_LEVEL_MIN=x)，更低级别的日志直接编译掉，运行时也无法打开
+#ifndef LOG_LEVEL_MIN
+#define LOG_LEVEL_MIN LOG_LEVEL
+#endif
+
 // ANSI 颜色代码
 #define COLOR_RESET   "\033[0m"
 #define COLOR_RED     "\033[31m"
@@ -26,57 +30,73 @@
 #define COLOR_CYAN    "\033[36m"
 #define COLOR_GRAY    "\033[90m"
 
-// 获取当前时间字符串
-static inline void get_timestamp(char *buf, size_t size) {
-    time_t now = time(NULL);
-    struct tm *tm_info = localtime(&now);
-    strftime(buf, size, "%H:%M:%S", tm_info);
-}
+// 单条日志（含时间戳和颜色）的最大长度，超出的部分截断
+#define LOG_RECORD_SIZE 256
+// 异步模式下环形队列的记录数（2 的幂）
+#define LOG_RING_SIZE 4096
+
+// 启动异步日志：之后的日志在调用线程里格式化后放进无锁环形队列，由后台线程批量写到 stdout
+// 队列满时直接丢弃并计数，不阻塞调用方；未启动时（或 logger_stop 之后）同步写 stdout
+// 成功返回 0，失败返回 -1（保持同步模式）
+int logger_start(void);
+// 写完队列中剩余的日志并停止后台线程，logger_start 会用 atexit 注册
+void logger_stop(void);
+// 因队列满而丢弃的日志条数
+uint64_t logger_dropped(void);
+
+// 写一条日志，一般通过下面的宏调用
+void log_write(int level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// ----- 运行时日志级别 -----
+// 当前级别，只通过下面的函数修改；宏里直接读取，关闭的级别只多一次读和比较，参数不会被求值
+extern int log_runtime_level;
+// 调整级别，低于 LOG_LEVEL_MIN 或不合法时返回 -1
+int log_set_level(int level);
+static inline int log_get_level(void) { return __atomic_load_n(&log_runtime_level, __ATOMIC_RELAXED); }
+// "debug"/"info"/"warn"/"error"（不区分大小写）或数字 0-3，不合法返回 -1
+int log_level_parse(const char *name);
+const char *log_level_name(int level);
+// 安装信号处理：SIGUSR1 让日志更详细（级别减一），SIGUSR2 让日志更简略（级别加一）
+int log_install_signals(void);
+
+#define log_enabled(level) ((level) >= LOG_LEVEL_MIN && (level) >= log_get_level())
 
 // 日志宏定义
-#if LOG_LEVEL <= LOG_LEVEL_DEBUG
-#define log_debug(fmt, ...) do { \
-    char ts[32]; \
-    get_timestamp(ts, sizeof(ts)); \
-    printf(COLOR_GRAY "[%s DEBUG] " fmt COLOR_RESET "\n", ts, ##__VA_ARGS__); \
-    fflush(stdout); \
-} while(0)
-#else
-#define log_debug(fmt, ...) ((void)0)
-#endif
+#define log_debug(fmt, ...) do { if (log_enabled(LOG_LEVEL_DEBUG)) log_write(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__); } while (0)
+#define log_info(fmt, ...)  do { if (log_enabled(LOG_LEVEL_INFO))  log_write(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__); } while (0)
+#define log_warn(fmt, ...)  do { if (log_enabled(LOG_LEVEL_WARN))  log_write(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__); } while (0)
+#define log_error(fmt, ...) do { if (log_enabled(LOG_LEVEL_ERROR)) log_write(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__); } while (0)
 
-#if LOG_LEVEL <= LOG_LEVEL_INFO
-#define log_info(fmt, ...) do { \
-    char ts[32]; \
-    get_timestamp(ts, sizeof(ts)); \
-    printf(COLOR_GREEN "[%s INFO] " fmt COLOR_RESET "\n", ts, ##__VA_ARGS__); \
-    fflush(stdout); \
-} while(0)
-#else
-#define log_info(fmt, ...) ((void)0)
-#endif
+// ----- 高频日志 -----
+// 状态按调用点、按线程保存（静态线程局部变量），不加锁；级别关闭时不更新任何状态
 
-#if LOG_LEVEL <= LOG_LEVEL_WARN
-#define log_warn(fmt, ...) do { \
-    char ts[32]; \
-    get_timestamp(ts, sizeof(ts)); \
-    printf(COLOR_YELLOW "[%s WARN] " fmt COLOR_RESET "\n", ts, ##__VA_ARGS__); \
-    fflush(stdout); \
-} while(0)
-#else
-#define log_warn(fmt, ...) ((void)0)
-#endif
+// 限速：同一调用点每 interval_ms 毫秒最多输出一条，期间被压下的条数附在下一条输出的末尾
+#define log_ratelimited(level, interval_ms, fmt, ...) do { \
+    if (log_enabled(level)) { \
+        static __thread long long log_rl_next_ = 0; \
+        static __thread unsigned log_rl_skipped_ = 0; \
+        long long log_rl_now_ = clock_mono_ms(); \
+        if (log_rl_now_ >= log_rl_next_) { \
+            log_rl_next_ = log_rl_now_ + (interval_ms); \
+            if (log_rl_skipped_ > 0) \
+                log_write(level, fmt " (%u similar suppressed)", ##__VA_ARGS__, log_rl_skipped_); \
+            else \
+                log_write(level, fmt, ##__VA_ARGS__); \
+            log_rl_skipped_ = 0; \
+        } else { \
+            log_rl_skipped_++; \
+        } \
+    } \
+} while (0)
 
-#if LOG_LEVEL <= LOG_LEVEL_ERROR
-#define log_error(fmt, ...) do { \
-    char ts[32]; \
-    get_timestamp(ts, sizeof(ts)); \
-    printf(COLOR_RED "[%s ERROR] " fmt COLOR_RESET "\n", ts, ##__VA_ARGS__); \
-    fflush(stdout); \
-} while(0)
-#else
-#define log_error(fmt, ...) ((void)0)
-#endif
+// 采样：同一调用点每 n 条输出一条（第 1、n+1、2n+1... 条）
+#define log_sampled(level, n, fmt, ...) do { \
+    if (log_enabled(level)) { \
+        static __thread unsigned log_sp_count_ = 0; \
+        if (log_sp_count_++ % (n) == 0) \
+            log_write(level, fmt " (sampled 1/%u)", ##__VA_ARGS__, (unsigned)(n)); \
+    } \
+} while (0)
 
 // 仅保留分级日志：debug/info/warn/error
 
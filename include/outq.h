@@ -0,0 +1,47 @@
+// 连接输出队列：按顺序把 wbuf 中拷贝的数据和引用外部内存的片段组织成 iovec，用 writev 一次发出
+#ifndef OUTQ_H
+#define OUTQ_H
+
+#include "buffer.h"
+#include <sys/uio.h>
+
+// 一次 writev 最多组装的 iovec 数
+#define OUTQ_IOV_MAX 64
+
+// 片段：ref 非 NULL 时引用外部内存，ref 为 NULL 时表示 wbuf 中接下来的 len 字节
+typedef struct out_seg_s {
+    const char *ref;
+    int len;
+} out_seg_t;
+
+// 只有用到引用片段时才分配 segs；没有片段时待发送数据就是整个 wbuf
+// wbuf 中 sealed 之后的字节（引用片段之后新追加的数据）视为隐式的最后一段
+typedef struct outq_s {
+    out_seg_t *segs;
+    int head;       // 第一个未发完的片段
+    int count;      // 片段总数（含已发完的）
+    int cap;
+    int sealed;     // wbuf 中已经被片段覆盖的字节数
+    int ref_bytes;  // 引用片段中尚未发送的字节数
+} outq_t;
+
+void outq_init(outq_t *q);
+void outq_free(outq_t *q);
+
+// 追加一个引用片段，不拷贝数据；ref 指向的内存在发送完成之前必须保持不变（如静态字符串）
+// 之前追加到 wbuf 的数据会排在它前面发送，返回 len，失败返回 -1
+int outq_add_ref(outq_t *q, buffer_t *wbuf, const char *ref, int len);
+// 待发送的总字节数
+static inline int outq_pending(const outq_t *q, const buffer_t *wbuf) {
+    return buffer_len(wbuf) + q->ref_bytes;
+}
+// 按发送顺序填充 iovec，返回填充的个数
+int outq_iov(const outq_t *q, const buffer_t *wbuf, struct iovec *iov, int max);
+// 已发送 n 字节：推进片段并消费 wbuf
+void outq_consume(outq_t *q, buffer_t *wbuf, int n);
+// 把引用片段拷贝进 wbuf，之后待发送数据就是连续的 wbuf（供只能发送单块内存的后端使用）
+int outq_flatten(outq_t *q, buffer_t *wbuf);
+// 队列为空时释放片段数组
+void outq_shrink(outq_t *q);
+
+#endif // OUTQ_H
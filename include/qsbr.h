@@ -0,0 +1,30 @@
+// QSBR（静止状态内存回收）：无锁读者不加锁访问共享数据，写者摘下的内存先挂起，
+// 等所有在线线程都经过一次静止点（不再持有任何共享指针的时刻）之后才真正释放
+// reactor 线程把每轮事件循环当作一次静止点：等待事件之前下线，醒来之后上线；
+// 在线期间读到的指针，到本线程下一次下线/静止点之前一直有效
+// 没有登记的线程（主线程、测试线程等）不能走无锁读路径，它们挂起的内存在交出时同步等待宽限期后释放
+#ifndef QSBR_H
+#define QSBR_H
+
+typedef void (*qsbr_free_fn)(void *ptr);
+
+// 登记当前线程，登记后处于下线状态；成功返回 0，线程数超过上限时返回 -1（该线程按未登记处理）
+int qsbr_register(void);
+// 当前线程是否已登记并且在线，只有在线线程可以无锁读取
+int qsbr_is_online(void);
+
+// 上线：之后读到的共享指针受保护，直到下一次 qsbr_quiescent / qsbr_offline
+void qsbr_online(void);
+// 下线：声明不再持有任何共享指针（例如进入 epoll_wait 之前），顺带回收已过宽限期的内存
+void qsbr_offline(void);
+// 静止点：相当于下线后立即上线
+void qsbr_quiescent(void);
+
+// 交出一块已经从共享结构中摘下的内存，宽限期过后调用 fn(ptr) 释放
+// 调用方不能持有会阻塞其他在线线程的锁（未登记的线程会在这里等待宽限期）
+void qsbr_retire(void *ptr, qsbr_free_fn fn);
+
+// 所有线程挂起、尚未释放的内存块数（不加锁读取，只用于统计）
+long qsbr_pending(void);
+
+#endif // QSBR_H
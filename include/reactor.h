@@ -0,0 +1,103 @@
+// Reactor 内部定义
+// 供 reactor.c 和各个 I/O 后端（如 reactor_uring.c）共享，业务代码只需要包含 server.h
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include "server.h"
+#include <pthread.h>
+
+// 单机最大连接数上限（用于分配 conn_list 大小）
+#define CONN_MAX 1000000
+// 支持监听的最大端口数量（reactor_mainloop 启动时使用）
+#define PORT_MAX 100
+// 每累计 N 个新连接打印一次聚合统计
+#define LOG_CONN_EVERY 10000
+// 每累计 N 个请求打印一次聚合统计
+#define LOG_REQ_EVERY 100000
+// "Client disconnected" 每个线程每隔这么久最多打一条，大量短连接时不刷屏
+#define LOG_DISCONNECT_INTERVAL_MS 1000
+// 最多支持的 reactor 线程数
+#define REACTOR_MAX 256
+// 连接池每次向系统申请的连接对象个数
+#define CONN_SLAB_SIZE 256
+// 默认每次唤醒最多 accept 的连接数
+#define ACCEPT_BATCH_DEFAULT 64
+
+// 性能统计（每个 reactor 一份，只由所属线程写入，print_stats 和 INFO 命令随时从其他线程读取）
+// 单写者只需要 relaxed 的读-改-写，不用带 lock 前缀的原子加法，热路径上没有任何同步开销；
+// 读者用 relaxed load 拿到的是某个时刻的完整值，不会读到撕裂的数据
+#define STAT_ADD(field, n) __atomic_store_n(&(field), __atomic_load_n(&(field), __ATOMIC_RELAXED) + (n), __ATOMIC_RELAXED)
+#define STAT_INC(field) STAT_ADD(field, 1)
+#define STAT_GET(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+struct server_stats {
+    long long total_connections;   // 累计连接数
+    long long active_connections;  // 当前活跃连接数
+    long long total_requests;      // 累计请求数
+    long long total_bytes_recv;    // 累计接收字节数
+    long long total_bytes_sent;    // 累计发送字节数
+    long long conn_pool_hits;      // 直接从空闲链表拿到连接对象的次数
+    long long conn_pool_misses;    // 空闲链表为空、需要新申请 slab 的次数
+    long long accept_wakeups;      // 监听套接字可读、进入 accept_cb 的次数
+    long long write_fast_path;     // 处理完请求后当场发完响应的次数（不经过 EPOLLOUT）
+    long long write_deferred;      // 内核发送缓冲区满、剩余响应等待 EPOLLOUT 发送的次数
+    long long timeouts;            // 因空闲/读/写超时被关闭的连接数
+};
+
+// 连接对象池：按 slab 批量申请，释放的连接挂回空闲链表复用，slab 本身不归还系统
+// 每个 reactor 一个，只由所属线程访问
+struct conn_pool {
+    struct conn *free_list;
+    int free_count;
+    int total;              // 已申请的连接对象总数
+    void **slabs;
+    int slab_count;
+    int slab_cap;
+};
+
+// 单个 reactor 的运行时状态
+// 多线程模式下每个线程独占一个 reactor：自己的 epoll、自己的监听套接字、自己的连接表，
+// 线程之间不共享任何网络层状态，因此回调中无需加锁
+struct reactor {
+    int id;
+    int epfd;               // epoll 后端使用，io_uring 后端为 -1
+    reactor_backend_t backend;  // 本 reactor 实际初始化的后端，线程按它选择事件循环
+    // 使用动态分配以避免静态数组过大导致链接失败
+    struct conn **conn_list;
+    struct server_stats stats;
+    struct conn_pool pool;
+    timer_wheel_t timers;   // 连接超时和定时任务
+    pthread_t tid;
+
+    int listen_fds[PORT_MAX];
+    int listen_count;
+
+    void *uring;            // io_uring 后端的私有状态（struct uring_ctx）
+};
+
+// 运行参数，启动后只读，所有 reactor 线程共享
+extern struct reactor_options global_opts;
+
+// 分配并初始化 fd 对应的连接数据（不注册任何事件），失败返回 NULL
+struct conn *conn_create(struct reactor *r, int fd);
+// 关闭连接并释放连接数据
+void close_conn(int fd);
+// 释放连接数据及其缓冲区，fd 需已关闭
+void conn_release(struct reactor *r, int fd);
+// rbuf 中已有新读到的数据：更新统计并调用业务处理函数，响应追加到 wbuf
+int process_request(struct reactor *r, struct conn *c);
+// 按连接当前所处阶段（空闲/读/写）重新设置超时，每次收发之后调用
+void conn_update_timer(struct reactor *r, struct conn *c);
+void print_stats();
+
+// ----- io_uring 后端 (reactor_uring.c) -----
+// 创建 ring 并注册 provided buffer ring，失败返回 -1（调用方回退到 epoll）
+int uring_reactor_init(struct reactor *r);
+// 释放已经创建的 ring（尚未开始运行），用于其他 reactor 初始化失败、整体回退到 epoll 时
+void uring_reactor_free(struct reactor *r);
+// io_uring 事件循环
+void *uring_reactor_run(void *arg);
+// 线程局部的当前 reactor，供后端设置
+void reactor_set_current(struct reactor *r);
+
+#endif // REACTOR_H
@@ -3,35 +3,33 @@
 #ifndef SERVER_H
 #define SERVER_H
 
-// 缓冲区大小配置
-// C1000K测试：设为1（最小内存占用，不收发数据）
-// QPS测试：设为1024或更大（需要实际收发数据）
-#define BUF_LEN 1024
+#include "buffer.h"
+#include "outq.h"
+#include "timer.h"
 
 // 协议类型枚举（内容级分发）
 typedef enum {
     PROTO_UNKNOWN = 0,
     PROTO_HTTP    = 1,
     PROTO_KVS     = 2,
-    PROTO_WS      = 3
+    PROTO_WS      = 3,
+    PROTO_COUNT
 } protocol_t;
 
 typedef int (*EVENT_CALLBACK)(int fd);
 // 工作流程：
-// 1. recv_cv接收客户端数据到rbuff
-// 2. 调用msg_handler处理业务逻辑，填充wbuff
-// 3. 调用send_cb发送数据到客户端
+// 1. recv_cv接收客户端数据追加到rbuf
+// 2. 调用msg_handler处理业务逻辑：从rbuf消费已处理的数据，把响应追加到wbuf
+// 3. 调用send_cb发送wbuf中的数据到客户端
 // msg_handler是实现业务逻辑的函数，也是操作哈希、红黑树等数据结构的函数
 
 struct conn {
     int fd;
 
-    char rbuff[BUF_LEN];
-    int rbuff_len;
-
-    char wbuff[BUF_LEN];
-    int wbuff_len;  // 需要发送的buffer长度
-    int wbuff_sent; // 已经发送的buffer长度
+    // 缓冲区按需分配、按需扩容，空闲连接不占用缓冲内存
+    buffer_t rbuf;  // 已读取、待处理的数据
+    buffer_t wbuf;  // 待发送的数据，发送多少消费多少
+    outq_t outq;    // 引用外部内存的输出片段（如静态响应体），和 wbuf 一起按顺序用 writev 发出
 
     EVENT_CALLBACK send_cb;
     union {
@@ -43,27 +41,89 @@ struct conn {
     int status;
     protocol_t protocol;
     int should_close;
+    int read_pending;  // 边缘触发模式：因响应未发完而暂停读取，发完后需要补读
+    unsigned int io_gen;  // io_uring 后端：连接代数，用于丢弃已关闭连接遗留的 CQE
+    struct conn *next_free;  // 连接池空闲链表
+    timer_node_t timer;      // 空闲/读/写超时，超时时间取决于连接当前所处阶段
+
+    // 增量解析状态：消息可能分多次读到，rbuf 会一直累积到消息完整
+    // parse_pos: rbuf 开头已经扫描过、确认不含消息结束标记（行尾或 HTTP 头结尾）的字节数，下次从这里继续扫描
+    int parse_pos;
 
     // WebSocket 相关字段
     // WebSocket的数据帧包括 帧头 + 可选的掩码 + 有效载荷（也就是实际数据）
-    // rbuff存储的是完整数据帧，payload指向实际数据，这样不用每次都计算偏移
     // 所有客户端到服务器的数据都需要进行掩码处理，所有从服务器到客户端的数据不能进行掩码处理
-    char* payload;  // 有效载荷指针
-    char mask[4];   // 掩码
+    int ws_frame_len;  // 当前帧的总长度（帧头+载荷），帧头还没解析时为 0
 };
 
 typedef int (*msg_handler)(struct conn *c);
 
+// I/O 后端
+typedef enum {
+    REACTOR_BACKEND_EPOLL = 0,
+    REACTOR_BACKEND_URING = 1   // io_uring：multishot accept + provided buffer ring + 链接的 send
+} reactor_backend_t;
+
+// 连接超时（毫秒），0 表示不限制；按协议分别配置，协议识别之前使用 PROTO_UNKNOWN 的配置
+struct conn_timeouts {
+    int idle_ms;    // 没有未完成的请求，等待下一个请求的最长时间
+    int read_ms;    // 已收到部分请求，等待请求收齐的最长时间
+    int write_ms;   // 响应发不出去（对端不读）的最长时间
+};
+
+// Reactor 运行参数，先用 reactor_options_init 填充默认值再按需修改
+struct reactor_options {
+    // reactor 线程数：每个线程独占一个 epoll、一组 SO_REUSEPORT 监听套接字和一张连接表
+    // 注意：msg_handler 会在多个线程中并发调用，业务层需要自行保证线程安全
+    int threads;
+    // 边缘触发模式：客户端套接字非阻塞 + EPOLLET，读写都循环到 EAGAIN
+    int edge_triggered;
+    // I/O 后端，io_uring 不可用时自动回退到 epoll；io_uring 下 edge_triggered 不生效
+    reactor_backend_t backend;
+    // 每个 reactor 启动时预分配的连接对象数量，0 表示用到时再按 slab 分配
+    int conn_prealloc;
+    // 监听套接字每次可读时最多 accept 的连接数（epoll 后端），1 表示每次唤醒只接受一个
+    int accept_batch;
+    // 水平触发模式：处理完请求后立即尝试发送响应，只有发不完时才注册 EPOLLOUT（默认开启）
+    // 关闭后每个响应都先切换到 EPOLLOUT、等下一轮 epoll_wait 再发送
+    int write_through;
+    // 每种协议的连接超时，默认全部不限制（C1000K 测试需要长期保持空闲连接）
+    struct conn_timeouts timeouts[PROTO_COUNT];
+    // 采集 recv/parse/exec/send 各阶段的延迟直方图，随统计信息一起输出；每个阶段多两次 clock_gettime
+    int latency_stats;
+};
+
 // 函数声明
+void reactor_options_init(struct reactor_options *opts);
 int reactor_mainloop(unsigned short port_start, int port_count, msg_handler handler);
+int reactor_mainloop_ex(unsigned short port_start, int port_count, msg_handler handler,
+                        const struct reactor_options *opts);
+
+// 把网络层统计按 "key:value" 逐行（CRLF 结尾）追加到 out，分为 server/clients/memory 三节
+// section 为 NULL 或 "all" 时输出全部，返回追加的长度；只读取各 reactor 的计数器，任意线程都可以调用
+int reactor_info(buffer_t *out, const char *section);
+// 同样的统计按 Prometheus 文本格式追加到 out，返回追加的长度
+int reactor_metrics(buffer_t *out);
+
+// 定时任务：在当前 reactor 线程的事件循环中延迟或周期执行回调
+// 只能在 reactor 线程中调用（例如 msg_handler 内），回调也在同一线程执行，不需要加锁
+struct reactor_timer;
+typedef void (*reactor_timer_fn)(void *arg);
+// delay_ms 后执行 fn(arg)；interval_ms > 0 时此后每隔 interval_ms 重复执行，直到取消
+// 一次性任务执行后句柄自动释放，不能再取消；失败返回 NULL
+struct reactor_timer *reactor_timer_add(int delay_ms, int interval_ms, reactor_timer_fn fn, void *arg);
+// 取消任务，可以在任务自己的回调中调用
+void reactor_timer_cancel(struct reactor_timer *t);
 
-// _handle: 负责解析和处理业务逻辑，将处理结果放到wbuffer中，返回数据长度
-// _encode: 负责将wbuffer中的数据编码为响应数据（协议头、分包、压缩等）
+// _handle: 负责解析和处理业务逻辑，将处理结果追加到wbuf中，返回追加的数据长度，出错返回负数
+// _encode: 负责将wbuf中的数据编码为响应数据（协议头、分包、压缩等）
 
 // 协议处理函数
 int http_handle(struct conn *c);
 int ws_handle(struct conn *c);
 int kvs_handle(struct conn *c);
+// KV 存储的指标（命令计数、引擎键数、各阶段延迟），Prometheus 文本格式，供 HTTP /metrics 使用
+int kvs_metrics(buffer_t *out);
 
 // 协议分发器
 int dispatcher_handler(struct conn *c);
@@ -0,0 +1,78 @@
+// 运行时统计：热路径分阶段延迟直方图、按命令的调用计数，以及 Prometheus 文本格式输出
+#ifndef STATS_H
+#define STATS_H
+
+#include "buffer.h"
+#include <stdint.h>
+#include <time.h>
+
+// 请求处理的各个阶段
+typedef enum {
+    LAT_RECV = 0,   // read 系统调用（epoll 后端；io_uring 的收发在内核中异步完成，不采集）
+    LAT_PARSE,      // 协议处理（msg_handler 耗时扣掉其中的命令执行）
+    LAT_EXEC,       // 单条 KVS 命令的执行（含引擎锁等待）
+    LAT_SEND,       // write/writev 系统调用（epoll 后端）
+    LAT_STAGE_COUNT
+} lat_stage_t;
+
+// 对数-线性直方图：每个 2 的幂区间再线性分成 2^LAT_SUB_BITS 格，相对误差不超过 1/2^LAT_SUB_BITS
+// 单位纳秒，覆盖到 2^LAT_MAX_BITS ns（约 18 分钟），更大的值计入最后一格
+#define LAT_SUB_BITS 4
+#define LAT_MAX_BITS 40
+#define LAT_BUCKETS ((LAT_MAX_BITS - LAT_SUB_BITS + 1) << LAT_SUB_BITS)
+
+typedef struct lat_hist_s {
+    uint64_t buckets[LAT_BUCKETS];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+} lat_hist_t;
+
+// 是否采集延迟，关闭时打点只剩一次分支判断；启动前设置，运行中只读
+extern int lat_enabled;
+
+// 打点时间（纳秒），未开启采集时返回 0
+static inline uint64_t lat_now(void) {
+    if (!lat_enabled) return 0;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+const char *lat_stage_name(lat_stage_t stage);
+
+// 记录从 start（lat_now 的返回值）到现在的耗时，start 为 0 时忽略
+// 直方图按线程分开，记录时不加锁
+void lat_record(lat_stage_t stage, uint64_t start);
+// 直接记录一个耗时
+void lat_record_ns(lat_stage_t stage, uint64_t ns);
+// 当前线程累计的 LAT_EXEC 耗时，用于从 msg_handler 的耗时中扣除命令执行部分
+uint64_t lat_exec_total(void);
+
+void lat_hist_record(lat_hist_t *h, uint64_t ns);
+// 第 p 百分位（0-100）的近似值（所在格的上界，不超过 max）
+uint64_t lat_hist_percentile(const lat_hist_t *h, double p);
+// 汇总所有线程某个阶段的直方图
+void lat_collect(lat_stage_t stage, lat_hist_t *out);
+// 把各阶段的 p50/p99/p999/max 打到日志
+void lat_report(void);
+// 以 "key:value" 行（CRLF 结尾）的形式追加各阶段的延迟分位数，供 INFO 命令使用
+void lat_info(buffer_t *out);
+// 以 Prometheus 直方图的形式追加各阶段的延迟（单位秒），未开启采集时不输出
+void lat_metrics(buffer_t *out);
+
+// ----- 命令计数 -----
+// 命令编号的上限，超出的编号不计数
+#define STATS_CMD_MAX 32
+// 当前线程的命令计数加一，不加锁
+void stats_cmd_inc(int cmd);
+// 汇总所有线程的命令计数，out 至少要有 STATS_CMD_MAX 个元素
+void stats_cmd_collect(uint64_t *out);
+
+// ----- Prometheus 文本格式 -----
+// 指标族的 "# HELP" 和 "# TYPE" 行，之后由调用方追加样本行
+void metrics_family(buffer_t *out, const char *name, const char *type, const char *help);
+// 只有一个无标签样本的指标
+void metrics_value(buffer_t *out, const char *name, const char *type, const char *help, long long value);
+
+#endif // STATS_H
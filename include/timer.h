@@ -0,0 +1,52 @@
+// 分层时间轮：每个 reactor 一个，只由所属线程访问，不需要加锁
+// 时间由调用方传入（单调时钟毫秒，reactor 用 clock_mono_ms() 的缓存值）
+// 添加、删除都是 O(1)；到期检查按 tick 推进，远期定时器随时间逐级下放到低层
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stddef.h>
+
+// 时间轮精度（毫秒），定时器最多晚这么久触发
+#define TIMER_TICK_MS 10
+// 第 0 层 256 个槽覆盖 2.56 秒，往上每层 64 个槽，共 4 层，最远约 7.7 天，更远的按最远处理
+#define TIMER_L0_BITS 8
+#define TIMER_LN_BITS 6
+#define TIMER_LEVELS 3
+#define TIMER_L0_SIZE (1 << TIMER_L0_BITS)
+#define TIMER_LN_SIZE (1 << TIMER_LN_BITS)
+
+typedef void (*timer_cb)(void *arg);
+
+// 定时器节点，嵌入到使用者的结构体中，不额外分配内存
+// 清零即为未启动状态
+typedef struct timer_node_s {
+    struct timer_node_s *prev;
+    struct timer_node_s *next;
+    unsigned long long expire;  // 到期的 tick
+    timer_cb cb;
+    void *arg;
+} timer_node_t;
+
+typedef struct timer_wheel_s {
+    timer_node_t l0[TIMER_L0_SIZE];                 // 各槽的链表头（哨兵）
+    timer_node_t ln[TIMER_LEVELS][TIMER_LN_SIZE];
+    unsigned long long cur;     // 下一个要处理的 tick
+    long long base_ms;          // tick 0 对应的时间
+    long long now_ms;           // 当前时间（最近一次推进或更新），添加定时器时以它为起点
+    int count;                  // 已启动的定时器数
+} timer_wheel_t;
+
+void timer_wheel_init(timer_wheel_t *tw, long long now_ms);
+// 启动定时器：delay_ms 后调用 cb(arg)；已经启动的会先取消再重新计时
+void timer_add(timer_wheel_t *tw, timer_node_t *t, int delay_ms, timer_cb cb, void *arg);
+// 取消定时器，未启动时什么也不做
+void timer_del(timer_wheel_t *tw, timer_node_t *t);
+static inline int timer_pending(const timer_node_t *t) { return t->next != NULL; }
+// 只更新当前时间、不执行回调：之后添加的定时器以 now_ms 为起点，到期的留给下一次 timer_wheel_advance
+static inline void timer_wheel_update(timer_wheel_t *tw, long long now_ms) { tw->now_ms = now_ms; }
+// 推进到 now_ms 并执行所有到期的回调，回调中可以添加或取消任意定时器；返回执行的回调数
+int timer_wheel_advance(timer_wheel_t *tw, long long now_ms);
+// 距离下一次需要推进的毫秒数，没有定时器时返回 -1，可直接作为 epoll_wait 的超时参数
+int timer_wheel_timeout(const timer_wheel_t *tw, long long now_ms);
+
+#endif // TIMER_H
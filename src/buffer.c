@@ -0,0 +1,161 @@
+#include "buffer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <sys/uio.h>
+
+// 一次读取时借用的栈空间，缓冲区本身保持较小，大请求再按实际长度扩容
+#define BUFFER_READ_EXTRA (64 * 1024)
+
+// 线程内缓冲池：空闲块首部存放下一块的指针
+struct buffer_chunk {
+    struct buffer_chunk *next;
+};
+static __thread struct buffer_chunk *chunk_free_list = NULL;
+static __thread int chunk_free_count = 0;
+
+// 分配 cap + 1 字节（多出的 1 字节留给结尾的 '\0'）
+static char *buffer_mem_alloc(int cap) {
+    if (cap == BUFFER_INIT_SIZE && chunk_free_list != NULL) {
+        struct buffer_chunk *chunk = chunk_free_list;
+        chunk_free_list = chunk->next;
+        chunk_free_count--;
+        return (char *)chunk;
+    }
+    return (char *)malloc((size_t)cap + 1);
+}
+
+static void buffer_mem_free(char *data, int cap) {
+    if (data == NULL) return;
+    if (cap == BUFFER_INIT_SIZE && chunk_free_count < BUFFER_POOL_MAX) {
+        struct buffer_chunk *chunk = (struct buffer_chunk *)data;
+        chunk->next = chunk_free_list;
+        chunk_free_list = chunk;
+        chunk_free_count++;
+        return;
+    }
+    free(data);
+}
+
+void buffer_init(buffer_t *b) {
+    b->data = NULL;
+    b->cap = 0;
+    b->head = 0;
+    b->tail = 0;
+}
+
+void buffer_free(buffer_t *b) {
+    buffer_mem_free(b->data, b->cap);
+    buffer_init(b);
+}
+
+int buffer_reserve(buffer_t *b, int n) {
+    if (n < 0) return -1;
+    if (b->cap - b->tail >= n) return 0;
+
+    int len = b->tail - b->head;
+    // 前面已消费的空间加起来够用，挪动数据即可
+    if (b->data != NULL && b->cap - len >= n) {
+        memmove(b->data, b->data + b->head, len);
+        b->head = 0;
+        b->tail = len;
+        b->data[len] = '\0';
+        return 0;
+    }
+
+    if (len + n > BUFFER_MAX_SIZE) return -1;
+    int cap = b->cap > 0 ? b->cap : BUFFER_INIT_SIZE;
+    while (cap < len + n) cap *= 2;
+
+    char *data = buffer_mem_alloc(cap);
+    if (data == NULL) return -1;
+    if (len > 0) memcpy(data, b->data + b->head, len);
+    data[len] = '\0';
+    buffer_mem_free(b->data, b->cap);
+    b->data = data;
+    b->cap = cap;
+    b->head = 0;
+    b->tail = len;
+    return 0;
+}
+
+void buffer_commit(buffer_t *b, int n) {
+    b->tail += n;
+    b->data[b->tail] = '\0';
+}
+
+int buffer_append(buffer_t *b, const void *data, int len) {
+    if (len <= 0) return 0;
+    if (buffer_reserve(b, len) < 0) return -1;
+    memcpy(b->data + b->tail, data, len);
+    buffer_commit(b, len);
+    return len;
+}
+
+int buffer_printf(buffer_t *b, const char *fmt, ...) {
+    va_list ap;
+    // 先按当前剩余空间尝试一次，放不下再按实际长度扩容重写
+    if (buffer_reserve(b, 64) < 0) return -1;
+    va_start(ap, fmt);
+    int n = vsnprintf(b->data + b->tail, (size_t)buffer_writable(b) + 1, fmt, ap);
+    va_end(ap);
+    if (n < 0) return -1;
+    if (n > buffer_writable(b)) {
+        if (buffer_reserve(b, n) < 0) return -1;
+        va_start(ap, fmt);
+        vsnprintf(b->data + b->tail, (size_t)n + 1, fmt, ap);
+        va_end(ap);
+    }
+    buffer_commit(b, n);
+    return n;
+}
+
+void buffer_consume(buffer_t *b, int n) {
+    if (n >= b->tail - b->head) {
+        buffer_clear(b);
+        return;
+    }
+    b->head += n;
+}
+
+void buffer_clear(buffer_t *b) {
+    b->head = 0;
+    b->tail = 0;
+    if (b->data != NULL) b->data[0] = '\0';
+}
+
+void buffer_shrink(buffer_t *b) {
+    if (b->head == b->tail && b->data != NULL) {
+        buffer_free(b);
+    }
+}
+
+int buffer_read_fd(buffer_t *b, int fd) {
+    char extra[BUFFER_READ_EXTRA];
+    if (b->data == NULL && buffer_reserve(b, BUFFER_INIT_SIZE) < 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    struct iovec iov[2];
+    int writable = buffer_writable(b);
+    iov[0].iov_base = b->data + b->tail;
+    iov[0].iov_len = writable;
+    iov[1].iov_base = extra;
+    iov[1].iov_len = sizeof(extra);
+
+    int n = (int)readv(fd, iov, 2);
+    if (n <= 0) return n;
+    if (n <= writable) {
+        buffer_commit(b, n);
+    } else {
+        buffer_commit(b, writable);
+        if (buffer_append(b, extra, n - writable) < 0) {
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+    return n;
+}
@@ -0,0 +1,20 @@
+#include "clock.h"
+
+__thread struct clock_cache clock_tls = { .str_sec = -1 };
+
+void clock_refresh(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    clock_tls.mono_ms = (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    clock_tls.wall_ms = (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    clock_tls.wall_sec = ts.tv_sec;
+
+    // 时间字符串每秒最多格式化一次
+    if (clock_tls.wall_sec != clock_tls.str_sec) {
+        struct tm tm_info;
+        localtime_r(&clock_tls.wall_sec, &tm_info);  // 多 reactor 线程并发打日志，使用可重入版本
+        strftime(clock_tls.timestr, sizeof(clock_tls.timestr), "%H:%M:%S", &tm_info);
+        clock_tls.str_sec = clock_tls.wall_sec;
+    }
+}
@@ -60,6 +60,30 @@ static int is_http(const char* buf, int len){
     return first_line_is_http(buf, len);
 }
 
+// 新连接的数据是否足够判断协议：至少要有完整的首行，HTTP 请求还要有完整的请求头
+// 数据不够时把已扫描的长度记在 c->parse_pos，下次只扫描新读到的部分
+// 返回 1 表示可以分发
+static int request_ready(struct conn* c, int *http){
+    char *data = buffer_peek(&c->rbuf);
+    int len = buffer_len(&c->rbuf);
+    if(memchr(data + c->parse_pos, '\n', len - c->parse_pos) == NULL){
+        c->parse_pos = len;
+        return 0;
+    }
+    *http = is_http(data, len);
+    if(!*http){
+        return 1;
+    }
+    // parse_pos 之前不含 \n，请求头结尾最多和它重叠 3 个字节
+    int from = c->parse_pos > 3 ? c->parse_pos - 3 : 0;
+    if(strstr(data + from, "\r\n\r\n") == NULL){
+        c->parse_pos = len;
+        return 0;
+    }
+    c->parse_pos = 0;
+    return 1;
+}
+
 // 协议分发器
 // 根据连接的协议类型或请求内容，分发到对应的处理函数
 int dispatcher_handler(struct conn* c){
@@ -75,8 +99,14 @@ int dispatcher_handler(struct conn* c){
     
     // 新连接，根据请求内容识别协议
     // 优先级：WebSocket升级 > HTTP > KVS
-    if(is_http(c->rbuff, c->rbuff_len)){
-        if(is_ws_upgrade_request(c->rbuff, c->rbuff_len)){
+    int http = 0;
+    if(!request_ready(c, &http)){
+        return 0;
+    }
+    const char *data = buffer_peek(&c->rbuf);
+    int len = buffer_len(&c->rbuf);
+    if(http){
+        if(is_ws_upgrade_request(data, len)){
             return ws_handle(c);  // ws_handle 内部会设置 protocol = PROTO_WS
         }
         return http_handle(c);
@@ -4,36 +4,93 @@
 
 static const char* HELLO_BODY = "<html><body>Hello</body></html>";
 
-int http_handle(struct conn* c){
-    const char* body = HELLO_BODY;
-    // 需要先算body长度，才能计算header
-    int body_len = (int)strlen(body);
+// Content-Length 预留的位数，指标正文不会超过这个长度
+#define METRICS_LEN_DIGITS 10
+
+// 请求行是否为 "<method> <path>"，path 之后只能是空格或查询串
+static int http_request_is(const char* data, int len, const char* method, const char* path){
+    int mlen = (int)strlen(method);
+    int plen = (int)strlen(path);
+    if(len < mlen + 1 + plen + 1){
+        return 0;
+    }
+    if(memcmp(data, method, mlen) != 0 || data[mlen] != ' '){
+        return 0;
+    }
+    data += mlen + 1;
+    if(memcmp(data, path, plen) != 0){
+        return 0;
+    }
+    return data[plen] == ' ' || data[plen] == '?';
+}
 
-    char header[256];
-    int header_len = snprintf(header, sizeof(header),
+// GET /metrics：Prometheus 文本格式的运行统计
+// 正文直接生成到 wbuf 里，Content-Length 先用空格占位，生成完再回填（头部字段值后的空白会被忽略），
+// 不需要额外的缓冲区。正文约 10KB（开启延迟统计时），wbuf 会从缓冲池的小块按 2 倍扩容几次；
+// 没有改成每个 reactor 一块固定的暂存区：响应在发送完之前要一直引用这块内存，同一 reactor 上的下一次抓取会把它覆盖，
+// 拷回 wbuf 又一样要扩容。抓取一般十几秒一次，这几次分配不在热路径上
+static int http_metrics(struct conn* c){
+    int start = buffer_len(&c->wbuf);
+    if(buffer_printf(&c->wbuf,
                      "HTTP/1.1 200 OK\r\n"
-                     "Content-Type: text/html; charset=utf-8\r\n"
-                     "Content-Length: %d\r\n"
+                     "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                     "Content-Length: ") < 0){
+        return -1;
+    }
+    int len_pos = buffer_len(&c->wbuf);
+    if(buffer_printf(&c->wbuf,
+                     "%*s\r\n"
                      "Connection: close\r\n"
                      "\r\n",
-                     body_len);
-
-    memset(c->wbuff, 0, BUF_LEN);
-    c->wbuff_len = 0;
-    c->wbuff_sent = 0;
-
-    if(header_len + body_len >= BUF_LEN){
+                     METRICS_LEN_DIGITS, "") < 0){
         return -1;
     }
+    int body_start = buffer_len(&c->wbuf);
+    reactor_metrics(&c->wbuf);
+    kvs_metrics(&c->wbuf);
+
+    // wbuf 扩容或整理时数据整体搬动，相对 buffer_peek 的偏移不变
+    char digits[METRICS_LEN_DIGITS + 1];
+    int n = snprintf(digits, sizeof(digits), "%d", buffer_len(&c->wbuf) - body_start);
+    memcpy(buffer_peek(&c->wbuf) + len_pos, digits, n);
+    return buffer_len(&c->wbuf) - start;
+}
 
-    memcpy(c->wbuff + c->wbuff_len, header, header_len);
-    c->wbuff_len += header_len;
-    memcpy(c->wbuff + c->wbuff_len, body, body_len);
-    c->wbuff_len += body_len;
+int http_handle(struct conn* c){
+    int ret;
+    if(http_request_is(buffer_peek(&c->rbuf), buffer_len(&c->rbuf), "GET", "/metrics")){
+        ret = http_metrics(c);
+        if(ret < 0){
+            return -1;
+        }
+    }else{
+        const char* body = HELLO_BODY;
+        // 需要先算body长度，才能计算header
+        int body_len = (int)strlen(body);
+
+        int start = buffer_len(&c->wbuf);
+        if(buffer_printf(&c->wbuf,
+                         "HTTP/1.1 200 OK\r\n"
+                         "Content-Type: text/html; charset=utf-8\r\n"
+                         "Content-Length: %d\r\n"
+                         "Connection: close\r\n"
+                         "\r\n",
+                         body_len) < 0){
+            return -1;
+        }
+        // 静态响应体直接引用，不拷贝进 wbuf
+        if(outq_add_ref(&c->outq, &c->wbuf, body, body_len) < 0){
+            return -1;
+        }
+        ret = buffer_len(&c->wbuf) - start + body_len;
+    }
+    // 请求的其余内容目前不影响响应，整体丢弃
+    buffer_clear(&c->rbuf);
+    c->parse_pos = 0;
 
     c->should_close = 1;
     if(c->protocol == PROTO_UNKNOWN){
         c->protocol = PROTO_HTTP;
     }
-    return c->wbuff_len;
+    return ret;
 }
@@ -113,7 +113,7 @@ int kvs_array_set(kvs_array_t* ins,  char* key, char* val){
         // 中间没有空位置，在末端插入
         ins->table[ins->count].key = copykey;
         ins->table[ins->count].val = copyval;
-        ins->count++;
+        __atomic_store_n(&ins->count, ins->count + 1, __ATOMIC_RELAXED);
         return KVS_OK;
     }
     
@@ -187,4 +187,9 @@ int kvs_array_exist(kvs_array_t* ins, char* key){
         return KVS_OK;  // 0 表示存在
     }
     return KVS_ERR_NOTFOUND;  // -3 表示不存在
-}
\ No newline at end of file
+}
+
+// 高水位边界（不加锁读取，只用于统计）
+int kvs_array_boundary(kvs_array_t* ins){
+    return ins ? __atomic_load_n(&ins->count, __ATOMIC_RELAXED) : 0;
+}
@@ -5,6 +5,8 @@
 
 // 定义全局变量
 kvs_array_t* global_array = NULL;
+int kvs_hash_engine = KVS_HASH_ENGINE_CHAIN;
+int kvs_hash_shards_opt = 1;
 
 // 释放内存 -> 封装的好处是，如果将来需要改变内存释放的方式，只需要修改这个函数
 void kvs_free(void* ptr){
@@ -16,6 +18,20 @@ void* kvs_malloc(size_t size){
     return malloc(size);
 }
 
+// 分配并清零，大块内存直接拿到内核清零的页，不需要再 memset
+void* kvs_calloc(size_t n, size_t size){
+    return calloc(n, size);
+}
+
+// 对齐分配，用于按缓存行隔开的结构
+void* kvs_malloc_aligned(size_t alignment, size_t size){
+    void *ptr = NULL;
+    if(posix_memalign(&ptr, alignment, size) != 0){
+        return NULL;
+    }
+    return ptr;
+}
+
 // 错误码转字符串
 const char *kvs_strerror(int errnum){
     switch(errnum){
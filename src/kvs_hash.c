@@ -1,8 +1,27 @@
 #include "kvstore.h"
 #include "kvs_hash.h"
+#include "kvs_hashfn.h"
+#include "qsbr.h"
+#include <stdint.h>
 #include <string.h>
 
+// 槽位数必须是 2 的幂，桶下标直接取哈希值的低位
+// 整张表的初始槽位数，分片时平均分给各分片（每片不少于 HASH_MIN_SHARD_SLOTS）
 #define HASH_DEFAULT_SLOTS 1024
+#define HASH_MIN_SHARD_SLOTS 64
+// 单个分片的最大槽位数（int 下标）
+#define HASH_MAX_SLOTS (1 << 30)
+// 负载因子（键数/槽位数）达到 1 时扩容为 2 倍；低于 1/HASH_SHRINK_RATIO 时缩容，不低于初始槽位数
+#define HASH_SHRINK_RATIO 8
+// 每次操作最多迁移的非空桶数，以及最多跳过的空桶数，保证单次操作的额外开销有上限
+#define HASH_REHASH_STEP 1
+#define HASH_REHASH_EMPTY_VISITS 10
+// HSCAN 每访问一个键最多允许跳过的空桶数，空表上一次调用的开销也有上限
+#define HASH_SCAN_EMPTY_VISITS 10
+// 无锁查找和迁移冲突时的重试次数，超过后改为加读锁查找
+#define HASH_RCU_RETRIES 4
+// 无锁查找单个桶最多走的节点数；负载因子不超过 1 时链都很短，走到这么长说明读到了正在迁移的链
+#define HASH_RCU_MAX_STEPS 64
 
 // ========== 全局变量 ==========
 hashtable_t global_hash_instance;
@@ -10,57 +29,194 @@ hashtable_t* global_hash = &global_hash_instance;
 
 /*
  * 哈希表节点：链式拉链中的一个元素，保存键和值的副本
+ * 键和值按实际长度紧跟在节点头后面（"key\0value\0"），一个键值对只分配一次
+ * 节点挂上链表之后内容不再改变（MOD 换一个新节点），无锁读者读到的键值总是完整的
  * NOTE: 仅在本文件内声明，保证 hash.h 暴露的 hashtable_t 保持不透明，便于后续替换实现
  */
 typedef struct hashnode_s {
-    char key[MAX_KEY_LEN];
-    char val[MAX_VALUE_LEN];
     struct hashnode_s *next;
+    uint64_t hash;              // 键的完整哈希值，遍历链表时先比较它，相等才比较键；rehash 时也不用重新计算
+    uint32_t key_len;           // 键长度（不含 '\0'）
+    char data[];                // 键、值
 } hashnode_t;
 
+// 桶数组：槽位数和桶放在一起分配，无锁读者读一次指针就能拿到一致的大小和桶
+typedef struct hashbuckets_s {
+    int slots;
+    hashnode_t *heads[];
+} hashbuckets_t;
+
+/*
+ * 并发约定：
+ *   - 所有修改都在分片写锁内进行，桶头和 next 指针用原子写发布，新节点先填好内容再挂上链表；
+ *   - 已登记 QSBR 且在线的线程（reactor 线程）查询不加锁，摘下的节点和迁移完的旧桶数组
+ *     都交给 qsbr_retire，等所有在线线程经过静止点之后才释放；
+ *   - 迁移一个桶会改写节点的 next，无锁读者可能因此漏掉键，所以迁移和换表期间 seq 为奇数，
+ *     读者未命中时检查 seq 没有变化才认为键不存在，否则重试。
+ */
+
 /* ---------- 工具函数 ---------- */
 
-static inline hashnode_t **_hash_nodes(hashtable_t *hash) {
-    return (hashnode_t **)hash->nodes;
+static inline hashbuckets_t *_hash_table(hash_shard_t *shard) {
+    return (hashbuckets_t *)shard->nodes;
+}
+
+static inline hashbuckets_t *_hash_rehash_table(hash_shard_t *shard) {
+    return (hashbuckets_t *)shard->rehash_nodes;
+}
+
+static inline int _hash_index(uint64_t hash, int size) {
+    return (int)(hash & (uint64_t)(size - 1));
+}
+
+// 分片由哈希值的最高 shard_bits 位选择；桶下标用低位（单个分片最多 2^30 个槽），两者不重叠
+static inline hash_shard_t *_hash_shard(hashtable_t *hash, uint64_t h) {
+    if (hash->shard_bits == 0) {
+        return &hash->shards[0];
+    }
+    return &hash->shards[h >> (64 - hash->shard_bits)];
+}
+
+static inline int _hash_is_rehashing(const hash_shard_t *shard) {
+    return shard->rehash_idx >= 0;
+}
+
+// 不加锁判断分片是否在 rehash，只用来决定加读锁还是写锁
+static inline int _hash_rehash_pending(hash_shard_t *shard) {
+    return __atomic_load_n(&shard->rehash_nodes, __ATOMIC_RELAXED) != NULL;
+}
+
+static inline char *_node_key(hashnode_t *node) {
+    return node->data;
+}
+
+static inline char *_node_val(hashnode_t *node) {
+    return node->data + node->key_len + 1;
+}
+
+// 修改链表指针（需要写锁）：release 保证无锁读者顺着它读到的节点内容是完整的
+static inline void _hash_link(hashnode_t **slot, hashnode_t *node) {
+    __atomic_store_n(slot, node, __ATOMIC_RELEASE);
+}
+
+// 顺序计数：写锁内成对调用，中间的修改对无锁读者来说是一次整体变化
+static inline void _hash_seq_begin(hash_shard_t *shard) {
+    __atomic_store_n(&shard->seq, shard->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void _hash_seq_end(hash_shard_t *shard) {
+    __atomic_store_n(&shard->seq, shard->seq + 1, __ATOMIC_RELEASE);
+}
+
+static inline int _hash_key_equal(hashnode_t *node, uint64_t hash, const char *key, size_t klen) {
+    return node->hash == hash && node->key_len == klen && memcmp(node->data, key, klen) == 0;
+}
+
+// 在桶链表中查找 key，prev 非空时同时返回前驱节点（用于删除；需要持有锁）
+static inline hashnode_t *_hash_find(hashnode_t *node, uint64_t hash, const char *key, size_t klen,
+                                     hashnode_t **prev) {
+    hashnode_t *p = NULL;
+    while (node != NULL) {
+        if (_hash_key_equal(node, hash, key, klen)) {
+            break;
+        }
+        p = node;
+        node = node->next;
+    }
+    if (prev != NULL) {
+        *prev = p;
+    }
+    return node;
+}
+
+// 在旧表和新表中查找 key，bucket 非空时返回所在桶的链表头（用于删除；需要持有锁）
+// 旧表中已迁移的桶都是空的，不需要额外判断
+static hashnode_t *_hash_lookup(hash_shard_t *shard, uint64_t h, const char *key, size_t klen,
+                                hashnode_t ***bucket, hashnode_t **prev) {
+    hashbuckets_t *table = _hash_table(shard);
+    hashnode_t **slot = &table->heads[_hash_index(h, table->slots)];
+    hashnode_t *node = _hash_find(*slot, h, key, klen, prev);
+    if (node == NULL && _hash_is_rehashing(shard)) {
+        table = _hash_rehash_table(shard);
+        slot = &table->heads[_hash_index(h, table->slots)];
+        node = _hash_find(*slot, h, key, klen, prev);
+    }
+    if (bucket != NULL) {
+        *bucket = slot;
+    }
+    return node;
 }
 
-static int _hash_index(const char *key, int size) {
-    if (key == NULL || size <= 0) {
+// 无锁查找（调用线程必须在 QSBR 中在线）：返回 1 命中，0 未命中，-1 和迁移冲突需要重试
+// 命中的节点内容不可变，不需要再校验；未命中只有在期间没有迁移过桶时才可信
+static int _hash_lookup_rcu(hash_shard_t *shard, uint64_t h, const char *key, size_t klen, hashnode_t **out) {
+    unsigned seq = __atomic_load_n(&shard->seq, __ATOMIC_ACQUIRE);
+    if (seq & 1) {
         return -1;
     }
+    // 先读旧表再读新表：换表时先换 nodes 再清 rehash_nodes，两张表至少有一张读到的是当前的
+    hashbuckets_t *tables[2];
+    tables[0] = __atomic_load_n((hashbuckets_t **)&shard->nodes, __ATOMIC_ACQUIRE);
+    tables[1] = __atomic_load_n((hashbuckets_t **)&shard->rehash_nodes, __ATOMIC_ACQUIRE);
+
+    for (int t = 0; t < 2; t++) {
+        if (tables[t] == NULL) {
+            continue;
+        }
+        hashnode_t *node = __atomic_load_n(&tables[t]->heads[_hash_index(h, tables[t]->slots)], __ATOMIC_ACQUIRE);
+        int steps = 0;
+        while (node != NULL) {
+            if (_hash_key_equal(node, h, key, klen)) {
+                *out = node;
+                return 1;
+            }
+            if (++steps > HASH_RCU_MAX_STEPS) {
+                return -1;
+            }
+            node = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+        }
+    }
 
-    int sum = 0;
-    int i = 0;
-    while (key[i] != 0) {
-        sum += key[i];
-        ++i;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&shard->seq, __ATOMIC_RELAXED) != seq) {
+        return -1;
     }
-    return sum % size;
+    return 0;
 }
 
-static hashnode_t *_hash_create_node(const char *key, const char *val) {
-    hashnode_t *node = (hashnode_t *)kvs_malloc(sizeof(hashnode_t));
+// 按键值的实际长度分配节点（长度已由 _hash_validate_key_value 检查）
+static hashnode_t *_hash_create_node(uint64_t hash, const char *key, size_t klen, const char *val, size_t vlen) {
+    hashnode_t *node = (hashnode_t *)kvs_malloc(sizeof(hashnode_t) + klen + 1 + vlen + 1);
     if (node == NULL) {
         return NULL;
     }
 
-    strncpy(node->key, key, MAX_KEY_LEN - 1);
-    node->key[MAX_KEY_LEN - 1] = '\0'; // 当源字符串长度等于或超过限制长度时，不会在目标数组末尾添加 \0
-    strncpy(node->val, val, MAX_VALUE_LEN - 1);
-    node->val[MAX_VALUE_LEN - 1] = '\0';
     node->next = NULL;
+    node->hash = hash;
+    node->key_len = (uint32_t)klen;
+    memcpy(_node_key(node), key, klen + 1);
+    memcpy(_node_val(node), val, vlen + 1);
 
     return node;
 }
 
-static void _hash_destroy_nodes(hashnode_t **nodes, int slots) {
-    if (nodes == NULL) {
+static hashbuckets_t *_hash_create_table(int slots) {
+    hashbuckets_t *table = (hashbuckets_t *)kvs_calloc(1, sizeof(hashbuckets_t) + slots * sizeof(hashnode_t *));
+    if (table != NULL) {
+        table->slots = slots;
+    }
+    return table;
+}
+
+static void _hash_destroy_table(hashbuckets_t *table) {
+    if (table == NULL) {
         return;
     }
 
     // 先遍历每个桶，释放每个桶中的链表节点
-    for (int i = 0; i < slots; ++i) {
-        hashnode_t *node = nodes[i];
+    for (int i = 0; i < table->slots; ++i) {
+        hashnode_t *node = table->heads[i];
         while (node != NULL) {
             hashnode_t *tmp = node->next;
             kvs_free(node);
@@ -68,220 +224,378 @@ static void _hash_destroy_nodes(hashnode_t **nodes, int slots) {
         }
     }
     // 再释放桶数组
-    kvs_free(nodes);
+    kvs_free(table);
 }
 
-static int _hash_validate_key_value(const char *key, const char *val) {
+// 检查并返回键和值的长度
+static int _hash_validate_key_value(const char *key, const char *val, size_t *klen, size_t *vlen) {
     if (key == NULL || val == NULL) {
         return KVS_ERR_PARAM;
     }
-    if ((int)strlen(key) >= MAX_KEY_LEN || (int)strlen(val) >= MAX_VALUE_LEN) {
+    *klen = strlen(key);
+    *vlen = strlen(val);
+    if (*klen >= MAX_KEY_LEN || *vlen >= UINT32_MAX) {
         return KVS_ERR_PARAM;
     }
     return KVS_OK;
 }
 
+/* ---------- 渐进式 rehash ---------- */
+
+// 开始迁移到 slots 个槽的新表；分配失败时保持原状，下次操作再试
+static void _hash_rehash_start(hash_shard_t *shard, int slots) {
+    hashbuckets_t *table = _hash_create_table(slots);
+    if (table == NULL) {
+        return;
+    }
+    shard->rehash_idx = 0;
+    __atomic_store_n(&shard->rehash_nodes, (void *)table, __ATOMIC_RELEASE);
+}
+
+static void _hash_resize_check(hash_shard_t *shard);
+
+// 迁移一小步：最多 HASH_REHASH_STEP 个非空桶、HASH_REHASH_EMPTY_VISITS 个空桶（需要写锁）
+// 节点整体挂到新表，不拷贝，之前 GET 拿到的 value 指针仍然有效
+static void _hash_rehash_step(hash_shard_t *shard) {
+    if (!_hash_is_rehashing(shard)) {
+        return;
+    }
+    hashbuckets_t *from = _hash_table(shard);
+    hashbuckets_t *to = _hash_rehash_table(shard);
+    int moved = 0;
+    int empty = 0;
+
+    while (shard->rehash_idx < from->slots && moved < HASH_REHASH_STEP) {
+        hashnode_t *node = from->heads[shard->rehash_idx];
+        if (node == NULL) {
+            shard->rehash_idx++;
+            if (++empty >= HASH_REHASH_EMPTY_VISITS) {
+                break;
+            }
+            continue;
+        }
+        _hash_seq_begin(shard);
+        while (node != NULL) {
+            hashnode_t *next = node->next;
+            hashnode_t **slot = &to->heads[_hash_index(node->hash, to->slots)];
+            __atomic_store_n(&node->next, *slot, __ATOMIC_RELAXED);
+            _hash_link(slot, node);
+            node = next;
+        }
+        __atomic_store_n(&from->heads[shard->rehash_idx++], NULL, __ATOMIC_RELAXED);
+        _hash_seq_end(shard);
+        moved++;
+    }
+
+    // 全部迁移完成，新表替换旧表；旧表可能还有无锁读者在看，解锁后交给 QSBR 释放
+    // 迁移期间键数可能又变了很多，重新检查一次
+    if (shard->rehash_idx >= from->slots) {
+        _hash_seq_begin(shard);
+        __atomic_store_n(&shard->nodes, (void *)to, __ATOMIC_RELEASE);
+        __atomic_store_n(&shard->max_slots, to->slots, __ATOMIC_RELAXED);
+        __atomic_store_n(&shard->rehash_nodes, NULL, __ATOMIC_RELEASE);
+        _hash_seq_end(shard);
+        shard->rehash_idx = -1;
+        shard->retired_nodes = from;
+        _hash_resize_check(shard);
+    }
+}
+
+// 插入或删除之后检查负载因子，需要时开始扩容或缩容（正在 rehash 时等它完成）
+static void _hash_resize_check(hash_shard_t *shard) {
+    if (_hash_is_rehashing(shard)) {
+        return;
+    }
+    if (shard->count >= shard->max_slots && shard->max_slots < HASH_MAX_SLOTS) {
+        _hash_rehash_start(shard, shard->max_slots * 2);
+    } else if (shard->max_slots > shard->min_slots && shard->count < shard->max_slots / HASH_SHRINK_RATIO) {
+        // 缩到负载因子 1/4 ~ 1/2 之间，和扩容阈值留出距离，避免在边界来回抖动
+        int slots = shard->min_slots;
+        while (slots < shard->count * 2) {
+            slots *= 2;
+        }
+        if (slots < shard->max_slots) {
+            _hash_rehash_start(shard, slots);
+        }
+    }
+}
+
+/* ---------- 分片 ---------- */
+
+static int _hash_shard_init(hash_shard_t *shard, int slots) {
+    memset(shard, 0, sizeof(*shard));
+    hashbuckets_t *table = _hash_create_table(slots);
+    if (table == NULL) {
+        return KVS_ERR_NOMEM;
+    }
+    if (pthread_rwlock_init(&shard->lock, NULL) != 0) {
+        kvs_free(table);
+        return KVS_ERR_INTERNAL;
+    }
+    shard->nodes = table;
+    shard->max_slots = slots;
+    shard->min_slots = slots;
+    shard->count = 0;
+    shard->rehash_nodes = NULL;
+    shard->rehash_idx = -1;
+    shard->retired_nodes = NULL;
+    shard->seq = 0;
+    return KVS_OK;
+}
+
+// 释放两张表的节点和桶数组，销毁读写锁（此时不能再有并发访问）
+static void _hash_shard_destroy(hash_shard_t *shard) {
+    _hash_destroy_table(_hash_table(shard));
+    _hash_destroy_table(_hash_rehash_table(shard));
+    kvs_free(shard->retired_nodes);
+    shard->nodes = NULL;
+    shard->rehash_nodes = NULL;
+    shard->retired_nodes = NULL;
+    shard->max_slots = 0;
+    shard->count = 0;
+    pthread_rwlock_destroy(&shard->lock);
+}
+
+// 读操作加锁（未登记 QSBR 的线程，或无锁查找多次冲突时）：平时只加读锁，多个线程可以同时查询；
+// 分片在 rehash 时改加写锁，顺带推进迁移，只读的负载下迁移也能完成
+static void _hash_read_lock(hash_shard_t *shard) {
+    if (_hash_rehash_pending(shard)) {
+        pthread_rwlock_wrlock(&shard->lock);
+        _hash_rehash_step(shard);
+    } else {
+        pthread_rwlock_rdlock(&shard->lock);
+    }
+}
+
+// 解锁；如果这次持锁期间完成了迁移，旧桶数组在锁外交给 QSBR（未登记的线程会在那里等宽限期）
+static void _hash_unlock(hash_shard_t *shard) {
+    void *retired = shard->retired_nodes;
+    if (retired != NULL) {
+        shard->retired_nodes = NULL;
+    }
+    pthread_rwlock_unlock(&shard->lock);
+    qsbr_retire(retired, kvs_free);
+}
+
 /* ---------- KVStore 对外接口 ---------- */
 
-// 初始化哈希表：分配桶数组并准备互斥锁
+// 初始化哈希表（不分片）
 int kvs_hash_create(hashtable_t *hash) {
-    if (hash == NULL) {
+    return kvs_hash_create_sharded(hash, 1);
+}
+
+// 初始化分成 shards 个分片的哈希表：每个分片分配桶数组并准备读写锁
+int kvs_hash_create_sharded(hashtable_t *hash, int shards) {
+    if (hash == NULL || shards < 1 || shards > HASH_MAX_SHARDS || (shards & (shards - 1)) != 0) {
         return KVS_ERR_PARAM;
     }
 
-    // 分配桶数组
-    hashnode_t **nodes = (hashnode_t **)kvs_malloc(sizeof(hashnode_t *) * HASH_DEFAULT_SLOTS);
-    if (nodes == NULL) {
+    // 分片数组按缓存行对齐，每个分片独占缓存行
+    hash_shard_t *arr = (hash_shard_t *)kvs_malloc_aligned(sizeof(hash_shard_t), shards * sizeof(hash_shard_t));
+    if (arr == NULL) {
         return KVS_ERR_NOMEM;
     }
 
-    memset(nodes, 0, sizeof(hashnode_t *) * HASH_DEFAULT_SLOTS);
-
-    hash->nodes = (void **)nodes;
-    hash->max_slots = HASH_DEFAULT_SLOTS;
-    hash->count = 0;
-
-    if (pthread_mutex_init(&hash->lock, NULL) != 0) {
-        _hash_destroy_nodes(nodes, HASH_DEFAULT_SLOTS);
-        hash->nodes = NULL;
-        hash->max_slots = 0;
-        return KVS_ERR_INTERNAL;
+    int slots = HASH_DEFAULT_SLOTS / shards;
+    if (slots < HASH_MIN_SHARD_SLOTS) {
+        slots = HASH_MIN_SHARD_SLOTS;
+    }
+    for (int i = 0; i < shards; i++) {
+        int ret = _hash_shard_init(&arr[i], slots);
+        if (ret != KVS_OK) {
+            while (--i >= 0) {
+                _hash_shard_destroy(&arr[i]);
+            }
+            kvs_free(arr);
+            return ret;
+        }
     }
 
+    hash->shards = arr;
+    hash->shard_count = shards;
+    hash->shard_bits = __builtin_ctz(shards);
     return KVS_OK;
 }
 
-// 销毁哈希表：释放节点和桶数组，销毁互斥锁
+// 销毁哈希表：逐个销毁分片，再释放分片数组
 int kvs_hash_destroy(hashtable_t *hash) {
     if (hash == NULL) {
         return KVS_ERR_PARAM;
     }
 
-    hashnode_t **nodes = _hash_nodes(hash);
-    _hash_destroy_nodes(nodes, hash->max_slots);
-
-    hash->nodes = NULL;
-    hash->max_slots = 0;
-    hash->count = 0;
+    for (int i = 0; i < hash->shard_count; i++) {
+        _hash_shard_destroy(&hash->shards[i]);
+    }
+    kvs_free(hash->shards);
 
-    pthread_mutex_destroy(&hash->lock);
+    hash->shards = NULL;
+    hash->shard_count = 0;
+    hash->shard_bits = 0;
     return KVS_OK;
 }
 
-// 插入键值对：key 不存在时头插入链表
+// 插入键值对：key 不存在时头插入链表（rehash 期间插入新表）
 int kvs_hash_set(hashtable_t *hash, char *key, char *value) {
     if (hash == NULL) {
         return KVS_ERR_PARAM;
     }
 
-    int check = _hash_validate_key_value(key, value);
+    size_t klen, vlen;
+    int check = _hash_validate_key_value(key, value, &klen, &vlen);
     if (check != KVS_OK) {
         return check;
     }
 
-    if (hash->nodes == NULL || hash->max_slots <= 0) {
+    if (hash->shards == NULL) {
         return KVS_ERR_INTERNAL;
     }
 
-    int idx = _hash_index(key, hash->max_slots);
-    if (idx < 0) {
-        return KVS_ERR_PARAM;
+    // 哈希和节点都在加锁之前准备好；表的大小会变，桶下标在锁内计算
+    uint64_t h = kvs_hash_bytes(key, klen);
+    hashnode_t *new_node = _hash_create_node(h, key, klen, value, vlen);
+    if (new_node == NULL) {
+        return KVS_ERR_NOMEM;
     }
 
-    hashnode_t **nodes = _hash_nodes(hash);
-
-    pthread_mutex_lock(&hash->lock);
-
-    hashnode_t *node = nodes[idx];
-    while (node != NULL) {
-        if (strcmp(node->key, key) == 0) {
-            pthread_mutex_unlock(&hash->lock);
-            return KVS_ERR_EXISTS;
-        }
-        node = node->next;
-    }
+    hash_shard_t *shard = _hash_shard(hash, h);
+    pthread_rwlock_wrlock(&shard->lock);
+    _hash_rehash_step(shard);
 
-    hashnode_t *new_node = _hash_create_node(key, value);
-    if (new_node == NULL) {
-        pthread_mutex_unlock(&hash->lock);
-        return KVS_ERR_NOMEM;
+    if (_hash_lookup(shard, h, key, klen, NULL, NULL) != NULL) {
+        _hash_unlock(shard);
+        kvs_free(new_node);
+        return KVS_ERR_EXISTS;
     }
 
-    new_node->next = nodes[idx];
-    nodes[idx] = new_node;
-    hash->count++;
+    hashbuckets_t *table = _hash_is_rehashing(shard) ? _hash_rehash_table(shard) : _hash_table(shard);
+    hashnode_t **slot = &table->heads[_hash_index(h, table->slots)];
+    new_node->next = *slot;
+    _hash_link(slot, new_node);
+    __atomic_store_n(&shard->count, shard->count + 1, __ATOMIC_RELAXED);
+    _hash_resize_check(shard);
 
-    pthread_mutex_unlock(&hash->lock);
+    _hash_unlock(shard);
     return KVS_OK;
 }
 
 // 查询键值：命中返回内部 value 指针
+// 已登记 QSBR 的在线线程不加锁查询，value 在本线程下一次静止点之前有效（reactor 线程即本轮事件循环内）；
+// 其他线程加读锁查询，value 只在没有并发删除/修改这个键时有效
 int kvs_hash_get(hashtable_t *hash, char *key, char **value) {
     if (hash == NULL || value == NULL) {
         return KVS_ERR_PARAM;
     }
     *value = NULL;
 
-    if (key == NULL || hash->nodes == NULL || hash->max_slots <= 0) {
-        return KVS_ERR_PARAM;
-    }
-
-    int idx = _hash_index(key, hash->max_slots);
-    if (idx < 0) {
+    if (key == NULL || hash->shards == NULL) {
         return KVS_ERR_PARAM;
     }
 
-    hashnode_t **nodes = _hash_nodes(hash);
-
-    pthread_mutex_lock(&hash->lock);
+    size_t klen = strlen(key);
+    uint64_t h = kvs_hash_bytes(key, klen);
+    hash_shard_t *shard = _hash_shard(hash, h);
+    hashnode_t *node = NULL;
 
-    hashnode_t *node = nodes[idx];
-    while (node != NULL) {
-        if (strcmp(node->key, key) == 0) {
-            *value = node->val;
-            pthread_mutex_unlock(&hash->lock);
-            return KVS_OK;
+    if (qsbr_is_online()) {
+        // rehash 期间顺带推进迁移（拿不到写锁就算了），只读的负载下迁移也能完成
+        if (_hash_rehash_pending(shard) && pthread_rwlock_trywrlock(&shard->lock) == 0) {
+            _hash_rehash_step(shard);
+            _hash_unlock(shard);
         }
-        node = node->next;
+        for (int i = 0; i < HASH_RCU_RETRIES; i++) {
+            int found = _hash_lookup_rcu(shard, h, key, klen, &node);
+            if (found == 1) {
+                *value = _node_val(node);
+                return KVS_OK;
+            }
+            if (found == 0) {
+                return KVS_ERR_NOTFOUND;
+            }
+        }
+    }
+
+    _hash_read_lock(shard);
+    node = _hash_lookup(shard, h, key, klen, NULL, NULL);
+    if (node != NULL) {
+        *value = _node_val(node);
+        _hash_unlock(shard);
+        return KVS_OK;
     }
 
-    pthread_mutex_unlock(&hash->lock);
+    _hash_unlock(shard);
     return KVS_ERR_NOTFOUND;
 }
 
-// 修改键值：仅在 key 存在时覆盖旧值
+// 修改键值：仅在 key 存在时替换旧值
+// 节点内容对无锁读者不可变，总是换一个新节点挂在原位置，旧节点交给 QSBR 延迟释放
 int kvs_hash_mod(hashtable_t *hash, char *key, char *value) {
-    int check = _hash_validate_key_value(key, value);
+    size_t klen, vlen;
+    int check = _hash_validate_key_value(key, value, &klen, &vlen);
     if (check != KVS_OK) {
         return check;
     }
 
-    if (hash == NULL || hash->nodes == NULL || hash->max_slots <= 0) {
+    if (hash == NULL || hash->shards == NULL) {
         return KVS_ERR_PARAM;
     }
 
-    int idx = _hash_index(key, hash->max_slots);
-    if (idx < 0) {
-        return KVS_ERR_PARAM;
+    uint64_t h = kvs_hash_bytes(key, klen);
+    hashnode_t *new_node = _hash_create_node(h, key, klen, value, vlen);
+    if (new_node == NULL) {
+        return KVS_ERR_NOMEM;
     }
+    hash_shard_t *shard = _hash_shard(hash, h);
 
-    hashnode_t **nodes = _hash_nodes(hash);
+    pthread_rwlock_wrlock(&shard->lock);
+    _hash_rehash_step(shard);
 
-    pthread_mutex_lock(&hash->lock);
-
-    hashnode_t *node = nodes[idx];
-    while (node != NULL) {
-        if (strcmp(node->key, key) == 0) {
-            strncpy(node->val, value, MAX_VALUE_LEN - 1);
-            node->val[MAX_VALUE_LEN - 1] = '\0';
-            pthread_mutex_unlock(&hash->lock);
-            return KVS_OK;
-        }
-        node = node->next;
+    hashnode_t **bucket = NULL;
+    hashnode_t *prev = NULL;
+    hashnode_t *node = _hash_lookup(shard, h, key, klen, &bucket, &prev);
+    if (node == NULL) {
+        _hash_unlock(shard);
+        kvs_free(new_node);
+        return KVS_ERR_NOTFOUND;
     }
 
-    pthread_mutex_unlock(&hash->lock);
-    return KVS_ERR_NOTFOUND;
+    new_node->next = node->next;
+    _hash_link(prev == NULL ? bucket : &prev->next, new_node);
+    _hash_unlock(shard);
+    qsbr_retire(node, kvs_free);
+    return KVS_OK;
 }
 
-// 删除键值对：链表中定位并移除节点
+// 删除键值对：链表中定位并移除节点，键数降得足够低时开始缩容
+// 摘下的节点可能还有无锁读者在看，交给 QSBR 延迟释放
 int kvs_hash_del(hashtable_t *hash, char *key) {
     if (hash == NULL || key == NULL) {
         return KVS_ERR_PARAM;
     }
 
-    if (hash->nodes == NULL || hash->max_slots <= 0) {
+    if (hash->shards == NULL) {
         return KVS_ERR_INTERNAL;
     }
 
-    int idx = _hash_index(key, hash->max_slots);
-    if (idx < 0) {
-        return KVS_ERR_PARAM;
-    }
-
-    hashnode_t **nodes = _hash_nodes(hash);
+    size_t klen = strlen(key);
+    uint64_t h = kvs_hash_bytes(key, klen);
+    hash_shard_t *shard = _hash_shard(hash, h);
 
-    pthread_mutex_lock(&hash->lock);
+    pthread_rwlock_wrlock(&shard->lock);
+    _hash_rehash_step(shard);
 
+    hashnode_t **bucket = NULL;
     hashnode_t *prev = NULL;
-    hashnode_t *node = nodes[idx];
-    while (node != NULL) {
-        if (strcmp(node->key, key) == 0) {
-            if (prev == NULL) {
-                nodes[idx] = node->next;
-            } else {
-                prev->next = node->next;
-            }
-            kvs_free(node);
-            hash->count--;
-            pthread_mutex_unlock(&hash->lock);
-            return KVS_OK;
-        }
-        prev = node;
-        node = node->next;
+    hashnode_t *node = _hash_lookup(shard, h, key, klen, &bucket, &prev);
+    if (node != NULL) {
+        _hash_link(prev == NULL ? bucket : &prev->next, node->next);
+        __atomic_store_n(&shard->count, shard->count - 1, __ATOMIC_RELAXED);
+        _hash_resize_check(shard);
+        _hash_unlock(shard);
+        qsbr_retire(node, kvs_free);
+        return KVS_OK;
     }
 
-    pthread_mutex_unlock(&hash->lock);
+    _hash_unlock(shard);
     return KVS_ERR_NOTFOUND;
 }
 
@@ -293,4 +607,145 @@ int kvs_hash_exist(hashtable_t *hash, char *key) {
         return KVS_OK;
     }
     return ret;
-}
\ No newline at end of file
+}
+
+/* ---------- 增量遍历 ---------- */
+
+// 64 位逐位反转
+static inline uint64_t _hash_rev(uint64_t v) {
+    v = ((v >> 1) & 0x5555555555555555ULL) | ((v & 0x5555555555555555ULL) << 1);
+    v = ((v >> 2) & 0x3333333333333333ULL) | ((v & 0x3333333333333333ULL) << 2);
+    v = ((v >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((v & 0x0F0F0F0F0F0F0F0FULL) << 4);
+    return __builtin_bswap64(v);
+}
+
+// 游标在 mask 覆盖的低位上按 "高位先加" 的顺序递增（反转、加一、再反转）
+// 表扩大一倍时，小表的桶 i 拆成大表的 i 和 i + size，两者在这个顺序里紧挨着，已经走过的前缀在新表里也都走过了；
+// 缩小时大表的几个桶合并成一个，最多重复返回，不会漏掉
+static inline uint64_t _hash_scan_advance(uint64_t v, uint64_t mask) {
+    v |= ~mask;
+    v = _hash_rev(v);
+    v++;
+    return _hash_rev(v);
+}
+
+// 把一个桶里以 prefix 开头的键交给回调，返回桶里的键数（含不匹配的）
+static int _hash_scan_bucket(hashnode_t *node, const char *prefix, size_t plen, kvs_scan_fn fn, void *arg) {
+    int n = 0;
+    for (; node != NULL; node = node->next, n++) {
+        if (node->key_len >= plen && memcmp(node->data, prefix, plen) == 0) {
+            fn(_node_key(node), arg);
+        }
+    }
+    return n;
+}
+
+// 在一个分片上走一个游标位置（需要持锁），返回访问的键数，*cursor 前进到下一个位置（0 表示本分片走完）
+// rehash 期间两张表都要看：先看小表的桶 v，再看大表里由它拆出来的所有桶
+static int _hash_scan_step(hash_shard_t *shard, uint64_t *cursor, const char *prefix, size_t plen,
+                           kvs_scan_fn fn, void *arg) {
+    uint64_t v = *cursor;
+    hashbuckets_t *small = _hash_table(shard);
+    int n = 0;
+
+    if (!_hash_is_rehashing(shard)) {
+        uint64_t m0 = (uint64_t)small->slots - 1;
+        n += _hash_scan_bucket(small->heads[v & m0], prefix, plen, fn, arg);
+        *cursor = _hash_scan_advance(v, m0);
+        return n;
+    }
+
+    hashbuckets_t *large = _hash_rehash_table(shard);
+    if (small->slots > large->slots) {
+        hashbuckets_t *tmp = small;
+        small = large;
+        large = tmp;
+    }
+    uint64_t m0 = (uint64_t)small->slots - 1;
+    uint64_t m1 = (uint64_t)large->slots - 1;
+
+    // 大表多出来的高位走完一圈时进位到小表的位上，游标自然前进到小表的下一个桶
+    n += _hash_scan_bucket(small->heads[v & m0], prefix, plen, fn, arg);
+    do {
+        n += _hash_scan_bucket(large->heads[v & m1], prefix, plen, fn, arg);
+        v = _hash_scan_advance(v, m1);
+    } while (v & (m0 ^ m1));
+    *cursor = v;
+    return n;
+}
+
+// 游标：高 32 位是分片编号，低 32 位是分片内的反向二进制游标（单个分片最多 2^30 个槽）
+// 一次调用访问约 count 个键或 count * HASH_SCAN_EMPTY_VISITS 个空桶就返回，每个分片单独加读锁，
+// 不会长时间占着锁，也不会让一次调用的耗时随表的大小增长
+int kvs_hash_scan(hashtable_t *hash, uint64_t cursor, int count, const char *prefix,
+                  kvs_scan_fn fn, void *arg, uint64_t *next) {
+    if (hash == NULL || hash->shards == NULL || fn == NULL || next == NULL || count < 1) {
+        return KVS_ERR_PARAM;
+    }
+    // 先按无符号比较分片号，高位超出 int 范围的游标不能截断成负数
+    if ((cursor >> 32) >= (uint64_t)hash->shard_count) {
+        return KVS_ERR_PARAM;
+    }
+    int idx = (int)(cursor >> 32);
+    uint64_t v = cursor & 0xFFFFFFFFULL;
+    if (prefix == NULL) {
+        prefix = "";
+    }
+    size_t plen = strlen(prefix);
+
+    int keys = count;
+    int empty = count * HASH_SCAN_EMPTY_VISITS;
+    while (keys > 0 && empty > 0) {
+        hash_shard_t *shard = &hash->shards[idx];
+        _hash_read_lock(shard);
+        do {
+            int n = _hash_scan_step(shard, &v, prefix, plen, fn, arg);
+            if (n == 0) {
+                empty--;
+            } else {
+                keys -= n;
+            }
+        } while (v != 0 && keys > 0 && empty > 0);
+        _hash_unlock(shard);
+
+        if (v != 0) {
+            break;
+        }
+        // 本分片走完，换下一个分片；全部走完时游标回到 0
+        if (++idx >= hash->shard_count) {
+            *next = 0;
+            return KVS_OK;
+        }
+    }
+    *next = ((uint64_t)idx << 32) | v;
+    return KVS_OK;
+}
+
+// 键值对数量和槽位数：各分片之和（不加锁读取，只用于统计）
+int kvs_hash_count(hashtable_t *hash) {
+    int total = 0;
+    for (int i = 0; hash != NULL && i < hash->shard_count; i++) {
+        total += __atomic_load_n(&hash->shards[i].count, __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+int kvs_hash_slots(hashtable_t *hash) {
+    int total = 0;
+    for (int i = 0; hash != NULL && i < hash->shard_count; i++) {
+        total += __atomic_load_n(&hash->shards[i].max_slots, __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+int kvs_hash_shards(hashtable_t *hash) {
+    return hash ? hash->shard_count : 0;
+}
+
+// 单个分片的键数，分片编号无效时返回 -1
+int kvs_hash_shard_count(hashtable_t *hash, int shard) {
+    if (hash == NULL || shard < 0 || shard >= hash->shard_count) {
+        return -1;
+    }
+    return __atomic_load_n(&hash->shards[shard].count, __ATOMIC_RELAXED);
+}
@@ -1,7 +1,11 @@
 #include "kvstore.h"
 #include "kvs_protocol.h"
 #include <string.h>
+#include <strings.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
 
 // NOTE: 
 // 协议类型并不是性能的决定因素，过早优化不如先解决核心问题
@@ -25,10 +29,12 @@ int kvs_tokenizer(char* msg, char** tokens){
         return KVS_ERR_PARAM;
     }
     int idx = 0;
-    char* token = strtok(msg, " \r\n");
-    while(token != NULL){
+    // 多 reactor 线程会并发调用，使用可重入的 strtok_r
+    char* saveptr = NULL;
+    char* token = strtok_r(msg, " \r\n", &saveptr);
+    while(token != NULL && idx < KVS_MAX_TOKENS){
         tokens[idx++] = token;
-        token = strtok(NULL, " \r\n"); // 后续调用传入NULL，继续分割
+        token = strtok_r(NULL, " \r\n", &saveptr); // 后续调用传入NULL，继续分割
     }
     return idx;
 }
@@ -37,9 +43,19 @@ int kvs_tokenizer(char* msg, char** tokens){
 static const char *command[] = {
 	"SET", "GET", "DEL", "MOD", "EXIST",        // 数组
 	"RSET", "RGET", "RDEL", "RMOD", "REXIST",   // 红黑树
-	"HSET", "HGET", "HDEL", "HMOD", "HEXIST"    // 哈希表
+	"HSET", "HGET", "HDEL", "HMOD", "HEXIST",   // 哈希表
+	"HSCAN",
+	"INFO", "STATS", "LOGLEVEL"                 // 服务器信息与管理
 };
 
+// 命令名，编号无效时返回 NULL
+const char *kvs_command_name(int cmd){
+    if(cmd < KVS_CMD_START || cmd >= KVS_CMD_COUNT){
+        return NULL;
+    }
+    return command[cmd];
+}
+
 // TODO: 考虑是否应该将命令识别器和命令执行器合并为一个函数?
 //       当前设计: 分离的识别器和执行器
 //       优点: 职责分离,便于测试和维护
@@ -60,142 +76,278 @@ int kvs_parser_command(char** tokens){
     return KVS_ERR_PARAM;
 }
 
+// 数组和红黑树引擎本身没有锁，多 reactor 线程下由执行器串行化访问
+// 锁覆盖 "操作 + 生成响应"，保证 GET 拿到的内部指针在拷贝进 response 前不会被其他线程释放
+// 哈希表（两种引擎）的锁只保护引擎内部结构，GET 返回的指针在解锁之后靠 QSBR 保持有效：
+// 换下/删除的值要等所有 reactor 线程结束本轮事件循环才释放，这里不需要再加锁
+static pthread_mutex_t array_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t rbtree_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// HSET 系列命令按启动时选择的引擎分发；两个引擎都用 QSBR 延迟释放值，HGET 的结果在本轮事件循环内有效
+static int hash_set(char *key, char *value){
+#if KVS_IS_SWISS
+    if(kvs_hash_engine == KVS_HASH_ENGINE_SWISS){
+        return kvs_swiss_set(global_swiss, key, value);
+    }
+#endif
+    return kvs_hash_set(global_hash, key, value);
+}
+
+static int hash_get(char *key, char **value){
+#if KVS_IS_SWISS
+    if(kvs_hash_engine == KVS_HASH_ENGINE_SWISS){
+        return kvs_swiss_get(global_swiss, key, value);
+    }
+#endif
+    return kvs_hash_get(global_hash, key, value);
+}
+
+static int hash_del(char *key){
+#if KVS_IS_SWISS
+    if(kvs_hash_engine == KVS_HASH_ENGINE_SWISS){
+        return kvs_swiss_del(global_swiss, key);
+    }
+#endif
+    return kvs_hash_del(global_hash, key);
+}
+
+static int hash_mod(char *key, char *value){
+#if KVS_IS_SWISS
+    if(kvs_hash_engine == KVS_HASH_ENGINE_SWISS){
+        return kvs_swiss_mod(global_swiss, key, value);
+    }
+#endif
+    return kvs_hash_mod(global_hash, key, value);
+}
+
+static int hash_exist(char *key){
+#if KVS_IS_SWISS
+    if(kvs_hash_engine == KVS_HASH_ENGINE_SWISS){
+        return kvs_swiss_exist(global_swiss, key);
+    }
+#endif
+    return kvs_hash_exist(global_hash, key);
+}
+
+// HSCAN 不带 COUNT 时每次访问的键数，以及 COUNT 的上限（控制单次调用的耗时和响应大小）
+#define KVS_SCAN_DEFAULT_COUNT 10
+#define KVS_SCAN_MAX_COUNT 1000
+
+static void hash_scan_emit(const char *key, void *arg){
+    buffer_printf((buffer_t *)arg, " %s", key);
+}
+
+// HSCAN cursor [COUNT n] [MATCH prefix]
+// 响应 "OK <下一个游标> key1 key2 ..."，游标为 0 表示遍历完成；键不含空格，一行放得下
+// COUNT 是每次访问的键数（过滤前），MATCH 只返回以 prefix 开头的键，本次可能一个也不返回而游标不为 0
+// 响应（含错误信息）直接写入 response，返回状态码
+static int hash_scan(char **tokens, buffer_t *response){
+#if KVS_IS_SWISS
+    if(kvs_hash_engine == KVS_HASH_ENGINE_SWISS){
+        buffer_printf(response, "ERROR: HSCAN requires the chain hash engine");
+        return KVS_ERR_PARAM;
+    }
+#endif
+    char *end = NULL;
+    errno = 0;
+    unsigned long long cursor = strtoull(tokens[1], &end, 10);
+    int ret = KVS_OK;
+    if(errno != 0 || end == tokens[1] || *end != '\0' || tokens[1][0] == '-'){
+        ret = KVS_ERR_PARAM;
+    }
+
+    int count = KVS_SCAN_DEFAULT_COUNT;
+    const char *prefix = NULL;
+    for(int i = 2; ret == KVS_OK && i < KVS_MAX_TOKENS && tokens[i] != NULL; i += 2){
+        char *arg = i + 1 < KVS_MAX_TOKENS ? tokens[i + 1] : NULL;
+        if(arg == NULL){
+            ret = KVS_ERR_PARAM;
+        } else if(strcasecmp(tokens[i], "COUNT") == 0){
+            count = atoi(arg);
+            if(count < 1){
+                ret = KVS_ERR_PARAM;
+            } else if(count > KVS_SCAN_MAX_COUNT){
+                count = KVS_SCAN_MAX_COUNT;
+            }
+        } else if(strcasecmp(tokens[i], "MATCH") == 0){
+            prefix = arg;
+        } else {
+            ret = KVS_ERR_PARAM;
+        }
+    }
+
+    // 遍历完才知道下一个游标，键先收集到临时缓冲区（线程内缓冲池的块），再接在游标后面
+    buffer_t keys;
+    buffer_init(&keys);
+    uint64_t next = 0;
+    if(ret == KVS_OK){
+        ret = kvs_hash_scan(global_hash, cursor, count, prefix, hash_scan_emit, &keys, &next);
+    }
+    if(ret == KVS_OK){
+        buffer_printf(response, "OK %llu", (unsigned long long)next);
+        buffer_append(response, buffer_peek(&keys), buffer_len(&keys));
+    } else {
+        buffer_printf(response, "%s", kvs_strerror(ret));
+    }
+    buffer_free(&keys);
+    return ret;
+}
+
 // TODO: 命令错误要怎么处理？
 // 命令执行器
-int kvs_executor_command(int cmd, char** tokens, char* response){
+int kvs_executor_command(int cmd, char** tokens, buffer_t* response){
     if(cmd < KVS_CMD_START || cmd >= KVS_CMD_COUNT){
         return KVS_ERR_PARAM;
     }
 
     int ret = KVS_OK;
+    int status = KVS_OK;
     char* key = tokens[1];
     char* value = tokens[2];
 
+    pthread_mutex_t *engine_lock = NULL;
+    if(cmd >= KVS_CMD_SET && cmd <= KVS_CMD_EXIST){
+        engine_lock = &array_lock;
+    } else if(cmd >= KVS_CMD_RSET && cmd <= KVS_CMD_REXIST){
+        engine_lock = &rbtree_lock;
+    }
+    if(engine_lock != NULL){
+        pthread_mutex_lock(engine_lock);
+    }
+
     switch(cmd){
         case KVS_CMD_SET:
             ret = kvs_array_set(global_array, key, value);
             if(ret == KVS_OK){
-                sprintf(response, "OK");
+                buffer_printf(response, "OK");
             } else {
-                sprintf(response, "%s", kvs_strerror(ret));
+                buffer_printf(response, "%s", kvs_strerror(ret));
             }
             break;
         case KVS_CMD_GET:
             ret = kvs_array_get(global_array, key, &value);
             if(ret == KVS_OK){
-                sprintf(response, "OK %s", value);
+                buffer_printf(response, "OK %s", value);
             } else {
-                sprintf(response, "%s", kvs_strerror(ret));
+                buffer_printf(response, "%s", kvs_strerror(ret));
             }
             break;
         case KVS_CMD_DEL:
             ret = kvs_array_del(global_array, key);
             if(ret == KVS_OK){
-                sprintf(response, "OK");
+                buffer_printf(response, "OK");
             } else {
-                sprintf(response, "%s", kvs_strerror(ret));
+                buffer_printf(response, "%s", kvs_strerror(ret));
             }
             break;
         case KVS_CMD_MOD:
             ret = kvs_array_mod(global_array, key, value);
             if(ret == KVS_OK){
-                sprintf(response, "OK");
+                buffer_printf(response, "OK");
             } else {
-                sprintf(response, "%s", kvs_strerror(ret));
+                buffer_printf(response, "%s", kvs_strerror(ret));
             }
             break;
         case KVS_CMD_EXIST:
             ret = kvs_array_exist(global_array, key);
             if(ret == KVS_OK){
-                sprintf(response, "OK");
+                buffer_printf(response, "OK");
             } else {
-                sprintf(response, "%s", kvs_strerror(ret));
+                buffer_printf(response, "%s", kvs_strerror(ret));
             }
             break;
         case KVS_CMD_RSET:
             ret = kvs_rbtree_set(global_rbtree, key, value);
             if (ret == KVS_OK) {
-                sprintf(response, "OK");
+                buffer_printf(response, "OK");
             } else {
-                sprintf(response, "%s", kvs_strerror(ret));
+                buffer_printf(response, "%s", kvs_strerror(ret));
             }
             break;
         case KVS_CMD_RGET:
             ret = kvs_rbtree_get(global_rbtree, key, &value);
             if (ret == KVS_OK) {
-                sprintf(response, "OK %s", value);
+                buffer_printf(response, "OK %s", value);
             } else {
-                sprintf(response, "%s", kvs_strerror(ret));
+                buffer_printf(response, "%s", kvs_strerror(ret));
             }
             break;
         case KVS_CMD_RDEL:
             ret = kvs_rbtree_del(global_rbtree, key);
             if (ret == KVS_OK) {
-                sprintf(response, "OK");
+                buffer_printf(response, "OK");
             } else {
-                sprintf(response, "%s", kvs_strerror(ret));
+                buffer_printf(response, "%s", kvs_strerror(ret));
             }
             break;
         case KVS_CMD_RMOD:
             ret = kvs_rbtree_mod(global_rbtree, key, value);
             if (ret == KVS_OK) {
-                sprintf(response, "OK");
+                buffer_printf(response, "OK");
             } else {
-                sprintf(response, "%s", kvs_strerror(ret));
+                buffer_printf(response, "%s", kvs_strerror(ret));
             }
             break;
         case KVS_CMD_REXIST:
             ret = kvs_rbtree_exist(global_rbtree, key);
             if (ret == KVS_OK) {
-                sprintf(response, "OK");
+                buffer_printf(response, "OK");
             } else {
-                sprintf(response, "%s", kvs_strerror(ret));
+                buffer_printf(response, "%s", kvs_strerror(ret));
             }
             break;
         case KVS_CMD_HSET:
-            ret = kvs_hash_set(global_hash, key, value);
+            ret = hash_set(key, value);
             if (ret == KVS_OK) {
-                sprintf(response, "OK");
+                buffer_printf(response, "OK");
             } else {
-                sprintf(response, "%s", kvs_strerror(ret));
+                buffer_printf(response, "%s", kvs_strerror(ret));
             }
             break;
         case KVS_CMD_HGET:
-            ret = kvs_hash_get(global_hash, key, &value);
+            ret = hash_get(key, &value);
             if (ret == KVS_OK) {
-                sprintf(response, "OK %s", value);
+                buffer_printf(response, "OK %s", value);
             } else {
-                sprintf(response, "%s", kvs_strerror(ret));
+                buffer_printf(response, "%s", kvs_strerror(ret));
             }
             break;
         case KVS_CMD_HDEL:
-            ret = kvs_hash_del(global_hash, key);
+            ret = hash_del(key);
             if (ret == KVS_OK) {
-                sprintf(response, "OK");
+                buffer_printf(response, "OK");
             } else {
-                sprintf(response, "%s", kvs_strerror(ret));
+                buffer_printf(response, "%s", kvs_strerror(ret));
             }
             break;
         case KVS_CMD_HMOD:
-            ret = kvs_hash_mod(global_hash, key, value);
+            ret = hash_mod(key, value);
             if (ret == KVS_OK) {
-                sprintf(response, "OK");
+                buffer_printf(response, "OK");
             } else {
-                sprintf(response, "%s", kvs_strerror(ret));
+                buffer_printf(response, "%s", kvs_strerror(ret));
             }
             break;
         case KVS_CMD_HEXIST:
-            ret = kvs_hash_exist(global_hash, key);
+            ret = hash_exist(key);
             if (ret == KVS_OK) {
-                sprintf(response, "OK");
+                buffer_printf(response, "OK");
             } else {
-                sprintf(response, "%s", kvs_strerror(ret));
+                buffer_printf(response, "%s", kvs_strerror(ret));
             }
             break;
+        case KVS_CMD_HSCAN:
+            status = hash_scan(tokens, response);
+            break;
         default:
-            sprintf(response, "ERROR: Unknown command");
-            return KVS_ERR_PARAM;
+            buffer_printf(response, "ERROR: Unknown command");
+            status = KVS_ERR_PARAM;
+            break;
+    }
+
+    if(engine_lock != NULL){
+        pthread_mutex_unlock(engine_lock);
     }
-    return KVS_OK;
+    return status;
 }
 
@@ -383,6 +383,7 @@ int kvs_rbtree_create(kvs_rbtree_t *inst) {
 
     inst->nil->color = BLACK;
     inst->root = inst->nil;
+    inst->count = 0;
 
     return KVS_OK;
 }
@@ -417,6 +418,7 @@ int kvs_rbtree_destroy_old(kvs_rbtree_t *inst) {
     kvs_free(inst->nil);
     inst->nil = NULL;
     inst->root = NULL;
+    inst->count = 0;
 
     return KVS_OK;
 }
@@ -499,6 +501,7 @@ int kvs_rbtree_destroy(kvs_rbtree_t *inst) {
     kvs_free(inst->nil);
     inst->nil = NULL;
     inst->root = NULL;
+    inst->count = 0;
 
     return KVS_OK;
 }
@@ -563,6 +566,7 @@ int kvs_rbtree_set(kvs_rbtree_t *inst, char *key, char *value) {
 
     // 插入红黑树
     rbtree_insert(inst, node);
+    __atomic_store_n(&inst->count, inst->count + 1, __ATOMIC_RELAXED);
 
     return KVS_OK;
 }
@@ -586,6 +590,7 @@ int kvs_rbtree_del(kvs_rbtree_t *inst, char *key) {
         if (deleted->value) kvs_free(deleted->value);
         kvs_free(deleted);
     }
+    __atomic_store_n(&inst->count, inst->count - 1, __ATOMIC_RELAXED);
 
     return KVS_OK;
 }
@@ -631,3 +636,10 @@ int kvs_rbtree_exist(kvs_rbtree_t *inst, char *key) {
     int ret = kvs_rbtree_get(inst, key, &value);
     return ret;  // 存在返回 KVS_OK，不存在返回 KVS_ERR_NOTFOUND
 }
+
+/**
+ * @brief 节点数（不加锁读取，只用于统计）
+ */
+int kvs_rbtree_count(kvs_rbtree_t *inst) {
+    return inst ? __atomic_load_n(&inst->count, __ATOMIC_RELAXED) : 0;
+}
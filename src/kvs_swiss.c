@@ -0,0 +1,448 @@
+#include "kvstore.h"
+#include "kvs_swiss.h"
+#include "kvs_hash.h"
+#include "kvs_hashfn.h"
+#include "qsbr.h"
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// 初始槽位数和缩容下限，和拉链哈希表保持一致
+#define SWISS_DEFAULT_CAPACITY 1024
+#define SWISS_MIN_CAPACITY SWISS_DEFAULT_CAPACITY
+#define SWISS_MAX_CAPACITY (1 << 30)
+// 最大负载因子 7/8：每组平均至少留 2 个空槽，查找不存在的键时很快遇到空槽结束
+#define SWISS_MAX_LOAD_NUM 7
+#define SWISS_MAX_LOAD_DEN 8
+// 键数低于槽位数的 1/SWISS_SHRINK_RATIO 时缩容
+#define SWISS_SHRINK_RATIO 8
+
+// 控制字节：最高位为 1 表示空槽或墓碑，为 0 时低 7 位是键的哈希值低 7 位
+#define SWISS_CTRL_EMPTY   ((int8_t)-128)   // 0x80
+#define SWISS_CTRL_DELETED ((int8_t)-2)     // 0xFE
+
+// ========== 全局变量 ==========
+swisstable_t global_swiss_instance;
+swisstable_t* global_swiss = &global_swiss_instance;
+
+// 槽：24 字节，一个缓存行放得下 2~3 个；键和值按实际长度在表外分配
+typedef struct swiss_slot_s {
+    uint64_t hash;      // 完整哈希值：控制字节匹配后先比较它，重建时也不用重新计算
+    char *key;
+    char *val;
+} swiss_slot_t;
+
+/* ---------- 工具函数 ---------- */
+
+static inline swiss_slot_t *_swiss_slots(swisstable_t *t) {
+    return (swiss_slot_t *)t->slots;
+}
+
+// 加锁之前判断表是否已创建；扩缩容会在锁内替换 ctrl，所以这里用原子读
+static inline int _swiss_ready(swisstable_t *t) {
+    return __atomic_load_n(&t->ctrl, __ATOMIC_RELAXED) != NULL;
+}
+
+// 哈希值的高 57 位选组，低 7 位存进控制字节，两者互不相关
+static inline size_t _swiss_h1(uint64_t hash) {
+    return (size_t)(hash >> 7);
+}
+
+static inline int8_t _swiss_h2(uint64_t hash) {
+    return (int8_t)(hash & 0x7f);
+}
+
+static inline int _swiss_max_load(int capacity) {
+    return capacity / SWISS_MAX_LOAD_DEN * SWISS_MAX_LOAD_NUM;
+}
+
+// 组内控制字节等于 b 的槽，第 i 位对应第 i 个槽
+static inline uint32_t _swiss_match(const int8_t *group, int8_t b) {
+#ifdef __SSE2__
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(b)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < SWISS_GROUP_WIDTH; i++) {
+        if (group[i] == b) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+// 组内可以写入的槽（空槽或墓碑），即控制字节最高位为 1
+static inline uint32_t _swiss_match_free(const int8_t *group) {
+#ifdef __SSE2__
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < SWISS_GROUP_WIDTH; i++) {
+        if (group[i] < 0) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+/*
+ * 探测以组为单位，组起点按 SWISS_GROUP_WIDTH 对齐，组序号按三角数递增（+1, +2, +3 ...），
+ * 组数是 2 的幂时能遍历所有组。遇到含空槽的组就可以停止：键如果存在，插入时一定停在这组或更早
+ */
+
+// 查找 key，返回槽下标，不存在返回 -1
+static int _swiss_find(swisstable_t *t, uint64_t hash, const char *key) {
+    swiss_slot_t *slots = _swiss_slots(t);
+    size_t mask = (size_t)(t->capacity / SWISS_GROUP_WIDTH) - 1;
+    size_t g = _swiss_h1(hash) & mask;
+    int8_t h2 = _swiss_h2(hash);
+
+    for (size_t step = 1; ; step++) {
+        const int8_t *group = t->ctrl + g * SWISS_GROUP_WIDTH;
+        uint32_t m = _swiss_match(group, h2);
+        while (m != 0) {
+            int i = (int)(g * SWISS_GROUP_WIDTH) + __builtin_ctz(m);
+            if (slots[i].hash == hash && strcmp(slots[i].key, key) == 0) {
+                return i;
+            }
+            m &= m - 1;
+        }
+        if (_swiss_match(group, SWISS_CTRL_EMPTY) != 0) {
+            return -1;
+        }
+        g = (g + step) & mask;
+    }
+}
+
+// 为一个不在表中的键找可写入的槽；负载上限保证一定能找到
+static int _swiss_find_free(const int8_t *ctrl, int capacity, uint64_t hash) {
+    size_t mask = (size_t)(capacity / SWISS_GROUP_WIDTH) - 1;
+    size_t g = _swiss_h1(hash) & mask;
+
+    for (size_t step = 1; ; step++) {
+        uint32_t m = _swiss_match_free(ctrl + g * SWISS_GROUP_WIDTH);
+        if (m != 0) {
+            return (int)(g * SWISS_GROUP_WIDTH) + __builtin_ctz(m);
+        }
+        g = (g + step) & mask;
+    }
+}
+
+// 按实际长度复制字符串
+static char *_swiss_strdup(const char *s) {
+    size_t len = strlen(s) + 1;
+    char *p = (char *)kvs_malloc(len);
+    if (p != NULL) {
+        memcpy(p, s, len);
+    }
+    return p;
+}
+
+// 键的长度限制和拉链哈希表相同（值不限长度），切换引擎不改变 HSET 系列命令的行为
+static int _swiss_validate_key_value(const char *key, const char *val) {
+    if (key == NULL || val == NULL) {
+        return KVS_ERR_PARAM;
+    }
+    if ((int)strlen(key) >= MAX_KEY_LEN) {
+        return KVS_ERR_PARAM;
+    }
+    return KVS_OK;
+}
+
+// 分配 capacity 个槽的控制字节和槽数组，控制字节全部置空
+static int _swiss_alloc(int capacity, int8_t **ctrl, swiss_slot_t **slots) {
+    *ctrl = (int8_t *)kvs_malloc(capacity);
+    *slots = (swiss_slot_t *)kvs_malloc((size_t)capacity * sizeof(swiss_slot_t));
+    if (*ctrl == NULL || *slots == NULL) {
+        kvs_free(*ctrl);
+        kvs_free(*slots);
+        return KVS_ERR_NOMEM;
+    }
+    memset(*ctrl, SWISS_CTRL_EMPTY, capacity);
+    return KVS_OK;
+}
+
+// 重建为 capacity 个槽：所有键按保存的哈希值重新放置，墓碑随之清除；键值内存不动
+// 分配失败时保持原表不变
+static int _swiss_resize(swisstable_t *t, int capacity) {
+    int8_t *ctrl;
+    swiss_slot_t *slots;
+    if (_swiss_alloc(capacity, &ctrl, &slots) != KVS_OK) {
+        return KVS_ERR_NOMEM;
+    }
+
+    swiss_slot_t *old = _swiss_slots(t);
+    for (int i = 0; i < t->capacity; i++) {
+        if (t->ctrl[i] < 0) {
+            continue;
+        }
+        int j = _swiss_find_free(ctrl, capacity, old[i].hash);
+        ctrl[j] = _swiss_h2(old[i].hash);
+        slots[j] = old[i];
+    }
+    kvs_free(t->ctrl);
+    kvs_free(t->slots);
+
+    __atomic_store_n(&t->ctrl, ctrl, __ATOMIC_RELAXED);
+    t->slots = slots;
+    __atomic_store_n(&t->capacity, capacity, __ATOMIC_RELAXED);
+    t->growth_left = _swiss_max_load(capacity) - t->count;
+    return KVS_OK;
+}
+
+// 插入前没有空余时重建：键数不到 3/4 说明空间主要被墓碑占用，原大小重建即可
+// （重建后至少空出 1/8，均摊到每次插入的搬移不超过 8 个槽），否则扩容为 2 倍
+static int _swiss_reserve(swisstable_t *t) {
+    if (t->growth_left > 0) {
+        return KVS_OK;
+    }
+    int capacity = t->capacity;
+    if (t->count >= capacity / 4 * 3) {
+        if (capacity >= SWISS_MAX_CAPACITY) {
+            return KVS_ERR_NOMEM;
+        }
+        capacity *= 2;
+    }
+    return _swiss_resize(t, capacity);
+}
+
+// 删除之后键数很少时缩到负载因子 1/4 ~ 1/2 之间；失败不影响删除本身
+static void _swiss_shrink_check(swisstable_t *t) {
+    if (t->capacity <= SWISS_MIN_CAPACITY || t->count >= t->capacity / SWISS_SHRINK_RATIO) {
+        return;
+    }
+    int capacity = SWISS_MIN_CAPACITY;
+    while (capacity < t->count * 2) {
+        capacity *= 2;
+    }
+    if (capacity < t->capacity) {
+        _swiss_resize(t, capacity);
+    }
+}
+
+/* ---------- KVStore 对外接口 ---------- */
+
+int kvs_swiss_create(swisstable_t *t) {
+    if (t == NULL) {
+        return KVS_ERR_PARAM;
+    }
+
+    int8_t *ctrl;
+    swiss_slot_t *slots;
+    if (_swiss_alloc(SWISS_DEFAULT_CAPACITY, &ctrl, &slots) != KVS_OK) {
+        return KVS_ERR_NOMEM;
+    }
+
+    t->ctrl = ctrl;
+    t->slots = slots;
+    t->capacity = SWISS_DEFAULT_CAPACITY;
+    t->count = 0;
+    t->growth_left = _swiss_max_load(SWISS_DEFAULT_CAPACITY);
+
+    if (pthread_mutex_init(&t->lock, NULL) != 0) {
+        kvs_free(ctrl);
+        kvs_free(slots);
+        t->ctrl = NULL;
+        t->slots = NULL;
+        t->capacity = 0;
+        return KVS_ERR_INTERNAL;
+    }
+
+    return KVS_OK;
+}
+
+int kvs_swiss_destroy(swisstable_t *t) {
+    if (t == NULL) {
+        return KVS_ERR_PARAM;
+    }
+
+    swiss_slot_t *slots = _swiss_slots(t);
+    for (int i = 0; i < t->capacity; i++) {
+        if (t->ctrl[i] >= 0) {
+            kvs_free(slots[i].key);
+            kvs_free(slots[i].val);
+        }
+    }
+    kvs_free(t->ctrl);
+    kvs_free(t->slots);
+
+    t->ctrl = NULL;
+    t->slots = NULL;
+    t->capacity = 0;
+    t->count = 0;
+    t->growth_left = 0;
+
+    pthread_mutex_destroy(&t->lock);
+    return KVS_OK;
+}
+
+// 插入键值对：key 已存在时返回 KVS_ERR_EXISTS
+int kvs_swiss_set(swisstable_t *t, char *key, char *value) {
+    if (t == NULL) {
+        return KVS_ERR_PARAM;
+    }
+
+    int check = _swiss_validate_key_value(key, value);
+    if (check != KVS_OK) {
+        return check;
+    }
+
+    if (!_swiss_ready(t)) {
+        return KVS_ERR_INTERNAL;
+    }
+
+    // 键值在锁外复制好，锁内只做查找和放置
+    uint64_t h = kvs_hash_str(key);
+    char *k = _swiss_strdup(key);
+    char *v = _swiss_strdup(value);
+    if (k == NULL || v == NULL) {
+        kvs_free(k);
+        kvs_free(v);
+        return KVS_ERR_NOMEM;
+    }
+
+    pthread_mutex_lock(&t->lock);
+
+    int ret = KVS_ERR_EXISTS;
+    if (_swiss_find(t, h, key) < 0) {
+        ret = _swiss_reserve(t);
+    }
+    if (ret != KVS_OK) {
+        pthread_mutex_unlock(&t->lock);
+        kvs_free(k);
+        kvs_free(v);
+        return ret;
+    }
+
+    int i = _swiss_find_free(t->ctrl, t->capacity, h);
+    // 占用空槽消耗余量，复用墓碑不消耗（墓碑已经计算在内）
+    if (t->ctrl[i] == SWISS_CTRL_EMPTY) {
+        t->growth_left--;
+    }
+    t->ctrl[i] = _swiss_h2(h);
+    swiss_slot_t *slot = &_swiss_slots(t)[i];
+    slot->hash = h;
+    slot->key = k;
+    slot->val = v;
+    __atomic_store_n(&t->count, t->count + 1, __ATOMIC_RELAXED);
+
+    pthread_mutex_unlock(&t->lock);
+    return KVS_OK;
+}
+
+// 查询键值：命中返回内部 value 指针
+// 值挂上之后不再修改，MOD/DEL 换下的内存交给 QSBR 延迟释放：reactor 线程拿到的 value 在本轮事件循环内有效，
+// 和拉链哈希表一样；未登记 QSBR 的线程只在没有并发删除/修改这个键时有效
+int kvs_swiss_get(swisstable_t *t, char *key, char **value) {
+    if (t == NULL || value == NULL) {
+        return KVS_ERR_PARAM;
+    }
+    *value = NULL;
+
+    if (key == NULL || !_swiss_ready(t)) {
+        return KVS_ERR_PARAM;
+    }
+
+    uint64_t h = kvs_hash_str(key);
+
+    pthread_mutex_lock(&t->lock);
+    int i = _swiss_find(t, h, key);
+    if (i >= 0) {
+        *value = _swiss_slots(t)[i].val;
+        pthread_mutex_unlock(&t->lock);
+        return KVS_OK;
+    }
+    pthread_mutex_unlock(&t->lock);
+    return KVS_ERR_NOTFOUND;
+}
+
+// 修改键值：总是换一块新内存（其他线程可能正在读旧值），旧值交给 QSBR 延迟释放
+int kvs_swiss_mod(swisstable_t *t, char *key, char *value) {
+    int check = _swiss_validate_key_value(key, value);
+    if (check != KVS_OK) {
+        return check;
+    }
+
+    if (t == NULL || !_swiss_ready(t)) {
+        return KVS_ERR_PARAM;
+    }
+
+    uint64_t h = kvs_hash_str(key);
+    char *v = _swiss_strdup(value);
+    if (v == NULL) {
+        return KVS_ERR_NOMEM;
+    }
+
+    pthread_mutex_lock(&t->lock);
+    int i = _swiss_find(t, h, key);
+    if (i < 0) {
+        pthread_mutex_unlock(&t->lock);
+        kvs_free(v);
+        return KVS_ERR_NOTFOUND;
+    }
+
+    swiss_slot_t *slot = &_swiss_slots(t)[i];
+    char *old = slot->val;
+    slot->val = v;
+
+    pthread_mutex_unlock(&t->lock);
+    qsbr_retire(old, kvs_free);
+    return KVS_OK;
+}
+
+// 删除键值对：所在组里还有空槽时直接置空（探测本来就会停在这一组），否则留下墓碑
+int kvs_swiss_del(swisstable_t *t, char *key) {
+    if (t == NULL || key == NULL) {
+        return KVS_ERR_PARAM;
+    }
+
+    if (!_swiss_ready(t)) {
+        return KVS_ERR_INTERNAL;
+    }
+
+    uint64_t h = kvs_hash_str(key);
+
+    pthread_mutex_lock(&t->lock);
+    int i = _swiss_find(t, h, key);
+    if (i < 0) {
+        pthread_mutex_unlock(&t->lock);
+        return KVS_ERR_NOTFOUND;
+    }
+
+    swiss_slot_t *slot = &_swiss_slots(t)[i];
+    char *k = slot->key;
+    char *v = slot->val;
+    const int8_t *group = t->ctrl + (i & ~(SWISS_GROUP_WIDTH - 1));
+    if (_swiss_match(group, SWISS_CTRL_EMPTY) != 0) {
+        t->ctrl[i] = SWISS_CTRL_EMPTY;
+        t->growth_left++;
+    } else {
+        t->ctrl[i] = SWISS_CTRL_DELETED;
+    }
+    __atomic_store_n(&t->count, t->count - 1, __ATOMIC_RELAXED);
+    _swiss_shrink_check(t);
+
+    pthread_mutex_unlock(&t->lock);
+    // 键只在锁内比较，可以直接释放；值可能还有线程在读
+    kvs_free(k);
+    qsbr_retire(v, kvs_free);
+    return KVS_OK;
+}
+
+// 判断键是否存在
+int kvs_swiss_exist(swisstable_t *t, char *key) {
+    char *value = NULL;
+    return kvs_swiss_get(t, key, &value);
+}
+
+// 键值对数量和槽位数（不加锁读取，只用于统计）
+int kvs_swiss_count(swisstable_t *t) {
+    return t ? __atomic_load_n(&t->count, __ATOMIC_RELAXED) : 0;
+}
+
+int kvs_swiss_slots(swisstable_t *t) {
+    return t ? __atomic_load_n(&t->capacity, __ATOMIC_RELAXED) : 0;
+}
@@ -1,12 +1,14 @@
 #include "kvstore.h"
+#include "kvs_hash.h"
 #include "kvs_protocol.h"
 #include "server.h"
 #include "logger.h"
+#include "stats.h"
+#include "qsbr.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-
-#define KVS_MAX_TOKENS 8
+#include <strings.h>
 
 // 根据命令类型获取最小参数个数（含命令关键字）
 static int kvs_required_tokens(int cmd){
@@ -18,70 +20,182 @@ static int kvs_required_tokens(int cmd){
         case KVS_CMD_HSET:
         case KVS_CMD_HMOD:
             return 3;
+        case KVS_CMD_INFO:
+        case KVS_CMD_STATS:
+        case KVS_CMD_LOGLEVEL:
+            return 1;
         default:
             return 2;
     }
 }
 
-// 统一追加 CRLF，保持协议响应格式
-static int kvs_append_crlf(char *response){
-    size_t len = strlen(response);
-    if(len + 2 >= BUF_LEN){
-        return KVS_ERR_INTERNAL;
+// INFO [section] / STATS [section]：服务器和引擎的运行统计
+// 节：server / clients / memory / engines / commandstats / latency，省略或为 all 时输出全部
+// 响应格式参考 Redis 的 bulk string："$<长度>\r\n" 后跟若干 "key:value\r\n" 行，再以 "\r\n" 结尾，
+// 客户端按长度读取，不会和流水线中后续命令的响应混在一起
+static void kvs_info(const char *section, buffer_t *response){
+    buffer_t body;
+    buffer_init(&body);
+
+    reactor_info(&body, section);
+    if(section == NULL || strcasecmp(section, "all") == 0 || strcasecmp(section, "engines") == 0){
+        buffer_printf(&body, "# Engines\r\n");
+#if KVS_IS_ARRAY
+        buffer_printf(&body, "array_boundary:%d\r\n", kvs_array_boundary(global_array));
+#endif
+#if KVS_IS_RBTREE
+        buffer_printf(&body, "rbtree_keys:%d\r\n", kvs_rbtree_count(global_rbtree));
+#endif
+#if KVS_IS_HASH
+        buffer_printf(&body, "hash_keys:%d\r\n", kvs_hash_count(global_hash));
+        buffer_printf(&body, "hash_slots:%d\r\n", kvs_hash_slots(global_hash));
+        int shards = kvs_hash_shards(global_hash);
+        buffer_printf(&body, "hash_shards:%d\r\n", shards);
+        if(shards > 1){
+            buffer_printf(&body, "hash_shard_keys:");
+            for(int i = 0; i < shards; i++){
+                buffer_printf(&body, i == 0 ? "%d" : ",%d", kvs_hash_shard_count(global_hash, i));
+            }
+            buffer_printf(&body, "\r\n");
+        }
+        // 已摘下、等 reactor 线程经过静止点后才释放的节点和桶数组
+        buffer_printf(&body, "hash_reclaim_pending:%ld\r\n", qsbr_pending());
+#endif
+#if KVS_IS_SWISS
+        buffer_printf(&body, "swiss_keys:%d\r\n", kvs_swiss_count(global_swiss));
+        buffer_printf(&body, "swiss_slots:%d\r\n", kvs_swiss_slots(global_swiss));
+#endif
+        buffer_printf(&body, "hash_engine:%s\r\n", kvs_hash_engine == KVS_HASH_ENGINE_SWISS ? "swiss" : "chain");
+    }
+    if(section == NULL || strcasecmp(section, "all") == 0 || strcasecmp(section, "commandstats") == 0){
+        uint64_t calls[STATS_CMD_MAX];
+        stats_cmd_collect(calls);
+        buffer_printf(&body, "# Commandstats\r\n");
+        for(int cmd = KVS_CMD_START; cmd < KVS_CMD_COUNT; cmd++){
+            if(calls[cmd] == 0){
+                continue;
+            }
+            buffer_printf(&body, "cmdstat_%s:calls=%llu\r\n", kvs_command_name(cmd), (unsigned long long)calls[cmd]);
+        }
     }
-    response[len] = '\r';
-    response[len + 1] = '\n';
-    response[len + 2] = '\0';
-    return (int)(len + 2);
+    if(section == NULL || strcasecmp(section, "all") == 0 || strcasecmp(section, "latency") == 0){
+        buffer_printf(&body, "# Latency\r\n");
+        lat_info(&body);
+    }
+
+    buffer_printf(response, "$%d\r\n", buffer_len(&body));
+    buffer_append(response, buffer_peek(&body), buffer_len(&body));
+    buffer_free(&body);
 }
 
-// KV存储消息处理函数
-int kvs_handler(char *msg, int length, char *response){
-    if(msg == NULL || response == NULL || length <= 0){
-        snprintf(response, BUF_LEN, "%s", kvs_strerror(KVS_ERR_PARAM));
-        return kvs_append_crlf(response);
+// 命令计数按命令编号存放
+_Static_assert(KVS_CMD_COUNT <= STATS_CMD_MAX, "STATS_CMD_MAX is smaller than KVS_CMD_COUNT");
+
+int kvs_metrics(buffer_t *out){
+    int start = buffer_len(out);
+    uint64_t calls[STATS_CMD_MAX];
+    stats_cmd_collect(calls);
+    metrics_family(out, "netlib_commands_total", "counter", "KVS commands processed, by command");
+    for(int cmd = KVS_CMD_START; cmd < KVS_CMD_COUNT; cmd++){
+        buffer_printf(out, "netlib_commands_total{cmd=\"%s\"} %llu\n", kvs_command_name(cmd), (unsigned long long)calls[cmd]);
     }
 
-    // 复制请求数据到本地缓冲区，避免原始数据被 tokenizer 修改
-    int copy_len = length;
-    if(copy_len >= BUF_LEN){
-        copy_len = BUF_LEN - 1;
+    metrics_family(out, "netlib_engine_keys", "gauge", "Keys stored in each engine");
+#if KVS_IS_ARRAY
+    buffer_printf(out, "netlib_engine_keys{engine=\"array\"} %d\n", kvs_array_boundary(global_array));
+#endif
+#if KVS_IS_RBTREE
+    buffer_printf(out, "netlib_engine_keys{engine=\"rbtree\"} %d\n", kvs_rbtree_count(global_rbtree));
+#endif
+#if KVS_IS_HASH
+    buffer_printf(out, "netlib_engine_keys{engine=\"hash\"} %d\n", kvs_hash_count(global_hash));
+#endif
+#if KVS_IS_SWISS
+    buffer_printf(out, "netlib_engine_keys{engine=\"swiss\"} %d\n", kvs_swiss_count(global_swiss));
+#endif
+#if KVS_IS_HASH
+    metrics_value(out, "netlib_hash_slots", "gauge", "Bucket count of the hash engine", kvs_hash_slots(global_hash));
+    metrics_value(out, "netlib_hash_shards", "gauge", "Independently locked shards of the hash engine", kvs_hash_shards(global_hash));
+    metrics_value(out, "netlib_hash_reclaim_pending", "gauge", "Unlinked hash entries waiting for a QSBR grace period", qsbr_pending());
+#endif
+#if KVS_IS_SWISS
+    metrics_value(out, "netlib_swiss_slots", "gauge", "Slot count of the SwissTable engine", kvs_swiss_slots(global_swiss));
+#endif
+
+    lat_metrics(out);
+    return buffer_len(out) - start;
+}
+
+// LOGLEVEL [debug|info|warn|error]：不带参数时返回当前级别，带参数时调整级别
+// 低于编译时 LOG_LEVEL_MIN 的级别已经被编译掉，无法打开
+static void kvs_loglevel(const char *arg, buffer_t *response){
+    if(arg == NULL){
+        buffer_printf(response, "%s", log_level_name(log_get_level()));
+        return;
+    }
+    int level = log_level_parse(arg);
+    if(level < 0){
+        buffer_printf(response, "ERROR Invalid log level");
+        return;
     }
+    if(log_set_level(level) != 0){
+        buffer_printf(response, "ERROR Level below compiled minimum (%s)", log_level_name(LOG_LEVEL_MIN));
+        return;
+    }
+    log_warn("Log level set to %s", log_level_name(level));
+    buffer_printf(response, "OK");
+}
 
-    char buffer[BUF_LEN];
-    memset(buffer, 0, sizeof(buffer));
-    memcpy(buffer, msg, copy_len);
-    buffer[copy_len] = '\0';
+// KV存储消息处理函数
+// msg 必须以 '\0' 结尾，解析时会被 tokenizer 原地修改；响应追加到 response，返回追加的长度
+int kvs_handler(char *msg, int length, buffer_t *response){
+    int start = buffer_len(response);
+    if(msg == NULL || response == NULL || length <= 0){
+        buffer_printf(response, "%s\r\n", kvs_strerror(KVS_ERR_PARAM));
+        return buffer_len(response) - start;
+    }
 
     // 解析 token
     char *tokens[KVS_MAX_TOKENS] = {0};
-    int token_count = kvs_tokenizer(buffer, tokens);
+    int token_count = kvs_tokenizer(msg, tokens);
     if(token_count <= 0){
-        snprintf(response, BUF_LEN, "%s", kvs_strerror(KVS_ERR_PARAM));
-        return kvs_append_crlf(response);
+        buffer_printf(response, "%s\r\n", kvs_strerror(KVS_ERR_PARAM));
+        return buffer_len(response) - start;
     }
 
     // 识别命令并校验参数数量
     int cmd = kvs_parser_command(tokens);
     if(cmd < KVS_CMD_START || cmd >= KVS_CMD_COUNT){
-        snprintf(response, BUF_LEN, "ERROR Unknown command");
-        return kvs_append_crlf(response);
+        buffer_printf(response, "ERROR Unknown command\r\n");
+        return buffer_len(response) - start;
     }
 
     if(token_count < kvs_required_tokens(cmd)){
-        snprintf(response, BUF_LEN, "ERROR Missing arguments");
-        return kvs_append_crlf(response);
+        buffer_printf(response, "ERROR Missing arguments\r\n");
+        return buffer_len(response) - start;
     }
+    stats_cmd_inc(cmd);
 
-    memset(response, 0, BUF_LEN);
-    // 执行命令填充响应
-    int ret = kvs_executor_command(cmd, tokens, response);
-    if(ret != KVS_OK){
-        // kvs_executor_command已填充response，此处仅确保带有CRLF
-        return kvs_append_crlf(response);
+    if(cmd == KVS_CMD_INFO || cmd == KVS_CMD_STATS || cmd == KVS_CMD_LOGLEVEL){
+        if(cmd == KVS_CMD_LOGLEVEL){
+            kvs_loglevel(token_count > 1 ? tokens[1] : NULL, response);
+        }else{
+            kvs_info(token_count > 1 ? tokens[1] : NULL, response);
+        }
+        if(buffer_append(response, "\r\n", 2) < 0){
+            return KVS_ERR_NOMEM;
+        }
+        return buffer_len(response) - start;
     }
 
-    return kvs_append_crlf(response);
+    // 执行命令填充响应，出错时 kvs_executor_command 也已填充错误信息
+    uint64_t t0 = lat_now();
+    kvs_executor_command(cmd, tokens, response);
+    lat_record(LAT_EXEC, t0);
+    if(buffer_append(response, "\r\n", 2) < 0){
+        return KVS_ERR_NOMEM;
+    }
+    return buffer_len(response) - start;
 }
 
 // 初始化KV存储
@@ -111,7 +225,15 @@ int kvs_init(){
 
     // 初始化哈希表
 #if KVS_IS_HASH
-    ret = kvs_hash_create(global_hash);
+    ret = kvs_hash_create_sharded(global_hash, kvs_hash_shards_opt);
+    if(ret != KVS_OK){
+        return ret;
+    }
+#endif
+
+    // 初始化 SwissTable
+#if KVS_IS_SWISS
+    ret = kvs_swiss_create(global_swiss);
     if(ret != KVS_OK){
         return ret;
     }
@@ -121,34 +243,158 @@ int kvs_init(){
 }
 
 // 这个函数暂时不必优化，比起网络IO的开销，一次额外的函数调用开销几乎可以忽略不计
+// 支持流水线：rbuf 中每一行（以 \n 结尾，可选的 \r 会被去掉）是一条命令，
+// 依次执行并把响应按顺序追加到 wbuf；最后不完整的一行留在 rbuf 等下一次读取，
+// 并记下已经扫描过的长度（c->parse_pos），大 value 分多次到达时不会从头重复查找行尾
 int kvs_handle(struct conn* c){
-    c->wbuff_len = kvs_handler(c->rbuff, c->rbuff_len, c->wbuff);
-    c->wbuff_sent = 0;
+    char *data = buffer_peek(&c->rbuf);
+    int len = buffer_len(&c->rbuf);
+    int pos = 0;
+    int total = 0;
+    int scan = c->parse_pos;
+
+    while(pos < len){
+        char *line = data + pos;
+        char *nl = (char*)memchr(line + scan, '\n', len - pos - scan);
+        scan = 0;
+        if(nl == NULL){
+            break;
+        }
+        int line_len = (int)(nl - line);
+        pos += line_len + 1;
+        if(line_len > 0 && line[line_len - 1] == '\r'){
+            line_len--;
+        }
+        // 空行直接跳过，不产生响应
+        if(line_len == 0){
+            continue;
+        }
+        line[line_len] = '\0';
+
+        int ret = kvs_handler(line, line_len, &c->wbuf);
+        if(ret < 0){
+            return ret;
+        }
+        total += ret;
+    }
+    buffer_consume(&c->rbuf, pos);
+    c->parse_pos = len - pos;
+
     c->should_close = 0;
     if(c->protocol == PROTO_UNKNOWN){
         c->protocol = PROTO_KVS;
     }
-    return c->wbuff_len;
+    return total;
 }
 
 int kvs_encode(struct conn* c){
-    return c->wbuff_len;
+    return buffer_len(&c->wbuf);
 }
 
 
+// 解析超时选项的值：MS 对所有协议生效，proto:MS 只对指定协议生效
+// which: 0=idle 1=read 2=write，成功返回 0
+static int parse_timeout_opt(const char *arg, int which, struct reactor_options *opts){
+    static const char *names[PROTO_COUNT] = { "unknown", "http", "kvs", "ws" };
+    int first = 0, last = PROTO_COUNT - 1;
+    const char *colon = strchr(arg, ':');
+    if(colon != NULL){
+        int proto = -1;
+        for(int p = 0; p < PROTO_COUNT; p++){
+            if(strlen(names[p]) == (size_t)(colon - arg) && strncmp(arg, names[p], colon - arg) == 0){
+                proto = p;
+            }
+        }
+        if(proto < 0){
+            return -1;
+        }
+        first = last = proto;
+        arg = colon + 1;
+    }
+    int ms = atoi(arg);
+    if(ms < 0){
+        return -1;
+    }
+    for(int p = first; p <= last; p++){
+        struct conn_timeouts *t = &opts->timeouts[p];
+        if(which == 0) t->idle_ms = ms;
+        else if(which == 1) t->read_ms = ms;
+        else t->write_ms = ms;
+    }
+    return 0;
+}
+
 int main(int argc, char* argv[]){
     int port = 2000;
     int port_count = 20;
-    
-    // TODO: port count 可配置
+    struct reactor_options opts;
+    reactor_options_init(&opts);
+    int hash_shards = 0;
 
-    // 解析命令行参数：起始端口号
-    if(argc > 1){
-        port = atoi(argv[1]);
+    // 解析命令行参数：<起始端口> [端口数量] [reactor线程数] [--选项...]
+    int pos = 0;
+    for(int i = 1; i < argc; i++){
+        if(strcmp(argv[i], "--et") == 0){
+            opts.edge_triggered = 1;
+        } else if(strcmp(argv[i], "--uring") == 0){
+            opts.backend = REACTOR_BACKEND_URING;
+        } else if(strcmp(argv[i], "--conn-prealloc") == 0 && i + 1 < argc){
+            opts.conn_prealloc = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--accept-batch") == 0 && i + 1 < argc){
+            opts.accept_batch = atoi(argv[++i]);
+        } else if(strcmp(argv[i], "--latency-stats") == 0){
+            opts.latency_stats = 1;
+        } else if(strcmp(argv[i], "--hash-engine") == 0 && i + 1 < argc){
+            i++;
+            if(strcmp(argv[i], "chain") == 0){
+                kvs_hash_engine = KVS_HASH_ENGINE_CHAIN;
+#if KVS_IS_SWISS
+            } else if(strcmp(argv[i], "swiss") == 0){
+                kvs_hash_engine = KVS_HASH_ENGINE_SWISS;
+#endif
+            } else {
+                log_error("Invalid --hash-engine value: %s", argv[i]);
+                return -1;
+            }
+        } else if(strcmp(argv[i], "--hash-shards") == 0 && i + 1 < argc){
+            hash_shards = atoi(argv[++i]);
+            if(hash_shards < 1 || hash_shards > HASH_MAX_SHARDS || (hash_shards & (hash_shards - 1)) != 0){
+                log_error("Invalid --hash-shards value: %s (power of two, 1-%d)", argv[i], HASH_MAX_SHARDS);
+                return -1;
+            }
+        } else if(strcmp(argv[i], "--no-write-through") == 0){
+            opts.write_through = 0;
+        } else if((strcmp(argv[i], "--idle-timeout") == 0 || strcmp(argv[i], "--read-timeout") == 0 ||
+                   strcmp(argv[i], "--write-timeout") == 0) && i + 1 < argc){
+            int which = argv[i][2] == 'i' ? 0 : (argv[i][2] == 'r' ? 1 : 2);
+            if(parse_timeout_opt(argv[i + 1], which, &opts) != 0){
+                log_error("Invalid %s value: %s", argv[i], argv[i + 1]);
+                return -1;
+            }
+            i++;
+        } else if(strncmp(argv[i], "--", 2) == 0){
+            log_error("Unknown option: %s", argv[i]);
+            return -1;
+        } else if(pos == 0){
+            port = atoi(argv[i]); pos++;
+        } else if(pos == 1){
+            port_count = atoi(argv[i]); pos++;
+        } else if(pos == 2){
+            opts.threads = atoi(argv[i]); pos++;
+        }
     }
 
-    log_info("Starting kvstore server on ports %d-%d (%d ports)...", 
-             port, port + port_count - 1, port_count);
+    log_info("Starting kvstore server on ports %d-%d (%d ports, %d threads)...", 
+             port, port + port_count - 1, port_count, opts.threads);
+
+    // 哈希表分片数：未指定时单线程不分片，多线程按线程数的 4 倍取 2 的幂，减少线程落在同一分片上的概率
+    if(hash_shards == 0){
+        hash_shards = 1;
+        while(opts.threads > 1 && hash_shards < opts.threads * 4 && hash_shards < HASH_MAX_SHARDS){
+            hash_shards *= 2;
+        }
+    }
+    kvs_hash_shards_opt = hash_shards;
 
     // 初始化KV存储
     int init_ret = kvs_init();
@@ -157,7 +403,16 @@ int main(int argc, char* argv[]){
         return -1;
     }
 
+    // 之后的日志交给后台线程输出，reactor 线程不再同步写 stdout
+    if(logger_start() != 0){
+        log_warn("Async logger unavailable, logging synchronously");
+    }
+    // kill -USR1 / -USR2 调整日志级别
+    if(log_install_signals() != 0){
+        log_warn("Failed to install log level signal handlers");
+    }
+
     // 注册分发器
     extern int dispatcher_handler(struct conn*);
-    return reactor_mainloop(port, port_count, dispatcher_handler);
+    return reactor_mainloop_ex(port, port_count, dispatcher_handler, &opts);
 }
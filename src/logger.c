@@ -0,0 +1,290 @@
+#include "logger.h"
+#include "clock.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+// 后台线程每次最多攒这么多字节再 write 一次
+#define LOG_BATCH_SIZE (64 * 1024)
+// 队列为空时后台线程的最长睡眠时间（毫秒），正常情况下由写入方唤醒
+#define LOG_IDLE_WAIT_MS 100
+
+// 环形队列的一格（有界 MPSC 队列，每格带序号）：
+// seq == pos 表示空闲，可以被第 pos 个写入者占用；seq == pos + 1 表示已写好，等待后台线程取走；
+// 取走后置为 pos + LOG_RING_SIZE，留给下一圈的写入者
+struct log_slot {
+    uint64_t seq;
+    int len;
+    char data[LOG_RECORD_SIZE];
+};
+
+static struct log_slot *ring = NULL;
+// 写入位置由各线程 CAS 竞争，读取位置只有后台线程使用，分开放在不同的缓存行避免伪共享
+static uint64_t ring_tail __attribute__((aligned(64))) = 0;
+static uint64_t ring_head __attribute__((aligned(64))) = 0;
+static uint64_t dropped = 0;
+
+int log_runtime_level = LOG_LEVEL < LOG_LEVEL_MIN ? LOG_LEVEL_MIN : LOG_LEVEL;
+
+static int started = 0;         // 1 表示异步模式
+static int running = 0;         // 后台线程是否继续运行
+static int sleeping = 0;        // 后台线程是否在等待唤醒
+static pthread_t flusher;
+static pthread_mutex_t wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake_cond = PTHREAD_COND_INITIALIZER;
+
+static const char *level_prefix(int level) {
+    switch (level) {
+        case LOG_LEVEL_DEBUG: return COLOR_GRAY "[%s DEBUG] ";
+        case LOG_LEVEL_INFO:  return COLOR_GREEN "[%s INFO] ";
+        case LOG_LEVEL_WARN:  return COLOR_YELLOW "[%s WARN] ";
+        default:              return COLOR_RED "[%s ERROR] ";
+    }
+}
+
+// 把一条日志格式化到 buf（大小 LOG_RECORD_SIZE），返回长度；过长时截断，但保留颜色复位和换行
+// 时间戳取事件循环缓存的时间字符串，reactor 线程打日志不调用 localtime_r
+static int log_format(char *buf, int level, const char *fmt, va_list ap) {
+    static const char tail[] = COLOR_RESET "\n";
+    const int room = LOG_RECORD_SIZE - (int)sizeof(tail);
+
+    int n = snprintf(buf, room + 1, level_prefix(level), clock_timestr());
+    if (n > room) n = room;
+    int m = vsnprintf(buf + n, room + 1 - n, fmt, ap);
+    if (m > 0) n += m > room - n ? room - n : m;
+    memcpy(buf + n, tail, sizeof(tail) - 1);
+    return n + (int)sizeof(tail) - 1;
+}
+
+static void write_all(const char *data, int len) {
+    while (len > 0) {
+        ssize_t n = write(STDOUT_FILENO, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        data += n;
+        len -= (int)n;
+    }
+}
+
+void log_write(int level, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+
+    if (!__atomic_load_n(&started, __ATOMIC_ACQUIRE)) {
+        char buf[LOG_RECORD_SIZE];
+        int len = log_format(buf, level, fmt, ap);
+        va_end(ap);
+        fwrite(buf, 1, len, stdout);
+        fflush(stdout);
+        return;
+    }
+
+    // 占一个空闲格；队列满时不等待，直接丢弃
+    uint64_t pos = __atomic_load_n(&ring_tail, __ATOMIC_RELAXED);
+    struct log_slot *slot;
+    for (;;) {
+        slot = &ring[pos & (LOG_RING_SIZE - 1)];
+        uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t)(seq - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring_tail, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+            va_end(ap);
+            return;
+        } else {
+            pos = __atomic_load_n(&ring_tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    // 直接格式化到队列里，不额外拷贝
+    slot->len = log_format(slot->data, level, fmt, ap);
+    va_end(ap);
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+    // 和后台线程的 "置 sleeping 再检查队列" 配对，保证不会在它刚要睡下时漏掉唤醒
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&sleeping, __ATOMIC_RELAXED)) {
+        pthread_mutex_lock(&wake_lock);
+        pthread_cond_signal(&wake_cond);
+        pthread_mutex_unlock(&wake_lock);
+    }
+}
+
+// 取走所有已写好的记录，攒满一批写一次；返回取走的条数
+static int log_drain(char *batch, int *batch_len) {
+    int count = 0;
+    for (;;) {
+        struct log_slot *slot = &ring[ring_head & (LOG_RING_SIZE - 1)];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != ring_head + 1) break;
+        if (*batch_len + slot->len > LOG_BATCH_SIZE) {
+            write_all(batch, *batch_len);
+            *batch_len = 0;
+        }
+        memcpy(batch + *batch_len, slot->data, slot->len);
+        *batch_len += slot->len;
+        __atomic_store_n(&slot->seq, ring_head + LOG_RING_SIZE, __ATOMIC_RELEASE);
+        ring_head++;
+        count++;
+    }
+    return count;
+}
+
+static void report_dropped(char *batch, int *batch_len, uint64_t *reported) {
+    uint64_t n = __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+    if (n == *reported) return;
+    char line[LOG_RECORD_SIZE];
+    int len = snprintf(line, sizeof(line), COLOR_YELLOW "[%s WARN] Logger queue full, %llu records dropped"
+                       COLOR_RESET "\n", clock_timestr(), (unsigned long long)(n - *reported));
+    if (len >= (int)sizeof(line)) len = (int)sizeof(line) - 1;
+    if (*batch_len + len > LOG_BATCH_SIZE) {
+        write_all(batch, *batch_len);
+        *batch_len = 0;
+    }
+    memcpy(batch + *batch_len, line, len);
+    *batch_len += len;
+    *reported = n;
+}
+
+// 只有后台线程使用
+static char batch[LOG_BATCH_SIZE];
+
+static void *flusher_run(void *arg) {
+    (void)arg;
+    int batch_len = 0;
+    uint64_t reported = 0;
+
+    while (__atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+        int n = log_drain(batch, &batch_len);
+        report_dropped(batch, &batch_len, &reported);
+        if (batch_len > 0) {
+            write_all(batch, batch_len);
+            batch_len = 0;
+        }
+        if (n > 0) continue;
+
+        // 队列为空：先声明要睡，再在锁内检查一次，写入方看到 sleeping 才会（同样在锁内）发信号
+        __atomic_store_n(&sleeping, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += LOG_IDLE_WAIT_MS * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+        pthread_mutex_lock(&wake_lock);
+        struct log_slot *slot = &ring[ring_head & (LOG_RING_SIZE - 1)];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != ring_head + 1 &&
+            __atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+            pthread_cond_timedwait(&wake_cond, &wake_lock, &ts);
+        }
+        pthread_mutex_unlock(&wake_lock);
+        __atomic_store_n(&sleeping, 0, __ATOMIC_RELAXED);
+    }
+
+    // 停止时已切回同步模式，把已经占了格的记录全部写完
+    while (ring_head != __atomic_load_n(&ring_tail, __ATOMIC_ACQUIRE)) {
+        if (log_drain(batch, &batch_len) == 0) sched_yield();
+    }
+    report_dropped(batch, &batch_len, &reported);
+    if (batch_len > 0) write_all(batch, batch_len);
+    return NULL;
+}
+
+int logger_start(void) {
+    if (started) return 0;
+    if (ring == NULL) {
+        ring = (struct log_slot *)calloc(LOG_RING_SIZE, sizeof(struct log_slot));
+        if (ring == NULL) return -1;
+    }
+    for (uint64_t i = 0; i < LOG_RING_SIZE; i++) {
+        ring[i].seq = i;
+    }
+    ring_head = ring_tail = 0;
+
+    // 切换前把 stdio 里缓存的同步输出先写出去，保持先后顺序
+    fflush(stdout);
+    running = 1;
+    if (pthread_create(&flusher, NULL, flusher_run, NULL) != 0) {
+        running = 0;
+        return -1;
+    }
+    __atomic_store_n(&started, 1, __ATOMIC_RELEASE);
+    static int registered = 0;
+    if (!registered) {
+        atexit(logger_stop);
+        registered = 1;
+    }
+    return 0;
+}
+
+void logger_stop(void) {
+    if (!__atomic_load_n(&started, __ATOMIC_ACQUIRE)) return;
+    __atomic_store_n(&started, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&running, 0, __ATOMIC_RELEASE);
+    pthread_mutex_lock(&wake_lock);
+    pthread_cond_signal(&wake_cond);
+    pthread_mutex_unlock(&wake_lock);
+    pthread_join(flusher, NULL);
+    // ring 不释放：停止前读到 started == 1 的线程可能还没写完最后一条
+}
+
+uint64_t logger_dropped(void) {
+    return __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+}
+
+static const char *level_names[] = { "debug", "info", "warn", "error" };
+
+const char *log_level_name(int level) {
+    if (level < LOG_LEVEL_DEBUG || level > LOG_LEVEL_ERROR) return "unknown";
+    return level_names[level];
+}
+
+int log_level_parse(const char *name) {
+    if (name == NULL) return -1;
+    for (int i = LOG_LEVEL_DEBUG; i <= LOG_LEVEL_ERROR; i++) {
+        if (strcasecmp(name, level_names[i]) == 0) return i;
+    }
+    if (name[0] >= '0' && name[0] <= '3' && name[1] == '\0') return name[0] - '0';
+    return -1;
+}
+
+int log_set_level(int level) {
+    if (level < LOG_LEVEL_MIN || level > LOG_LEVEL_ERROR) return -1;
+    __atomic_store_n(&log_runtime_level, level, __ATOMIC_RELAXED);
+    return 0;
+}
+
+// 信号处理函数里只做一次原子读写，是异步信号安全的
+static void log_signal_handler(int sig) {
+    int level = __atomic_load_n(&log_runtime_level, __ATOMIC_RELAXED);
+    level += sig == SIGUSR1 ? -1 : 1;
+    if (level >= LOG_LEVEL_MIN && level <= LOG_LEVEL_ERROR) {
+        __atomic_store_n(&log_runtime_level, level, __ATOMIC_RELAXED);
+    }
+}
+
+int log_install_signals(void) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = log_signal_handler;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGUSR1, &sa, NULL) != 0) return -1;
+    if (sigaction(SIGUSR2, &sa, NULL) != 0) return -1;
+    return 0;
+}
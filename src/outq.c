@@ -0,0 +1,125 @@
+#include "outq.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define OUTQ_INIT_SEGS 8
+
+void outq_init(outq_t *q) {
+    memset(q, 0, sizeof(*q));
+}
+
+void outq_free(outq_t *q) {
+    free(q->segs);
+    outq_init(q);
+}
+
+static int outq_push(outq_t *q, const char *ref, int len) {
+    if (q->count == q->cap) {
+        // 前面已发完的片段先挪走
+        if (q->head > 0) {
+            memmove(q->segs, q->segs + q->head, sizeof(out_seg_t) * (q->count - q->head));
+            q->count -= q->head;
+            q->head = 0;
+        }
+        if (q->count == q->cap) {
+            int cap = q->cap ? q->cap * 2 : OUTQ_INIT_SEGS;
+            out_seg_t *segs = (out_seg_t *)realloc(q->segs, sizeof(out_seg_t) * cap);
+            if (segs == NULL) return -1;
+            q->segs = segs;
+            q->cap = cap;
+        }
+    }
+    q->segs[q->count].ref = ref;
+    q->segs[q->count].len = len;
+    q->count++;
+    return 0;
+}
+
+int outq_add_ref(outq_t *q, buffer_t *wbuf, const char *ref, int len) {
+    if (len <= 0) return 0;
+    // 先把之前追加到 wbuf 的数据封成一段，保证发送顺序
+    int unsealed = buffer_len(wbuf) - q->sealed;
+    if (unsealed > 0) {
+        if (outq_push(q, NULL, unsealed) < 0) return -1;
+        q->sealed += unsealed;
+    }
+    if (outq_push(q, ref, len) < 0) return -1;
+    q->ref_bytes += len;
+    return len;
+}
+
+int outq_iov(const outq_t *q, const buffer_t *wbuf, struct iovec *iov, int max) {
+    const char *data = buffer_peek(wbuf);
+    int n = 0;
+    int off = 0;
+    for (int i = q->head; i < q->count && n < max; i++) {
+        const out_seg_t *seg = &q->segs[i];
+        if (seg->ref != NULL) {
+            iov[n].iov_base = (void *)seg->ref;
+        } else {
+            iov[n].iov_base = (void *)(data + off);
+            off += seg->len;
+        }
+        iov[n].iov_len = seg->len;
+        n++;
+    }
+    int tail = buffer_len(wbuf) - q->sealed;
+    if (n < max && tail > 0) {
+        iov[n].iov_base = (void *)(data + q->sealed);
+        iov[n].iov_len = tail;
+        n++;
+    }
+    return n;
+}
+
+void outq_consume(outq_t *q, buffer_t *wbuf, int n) {
+    while (n > 0 && q->head < q->count) {
+        out_seg_t *seg = &q->segs[q->head];
+        int k = n < seg->len ? n : seg->len;
+        if (seg->ref != NULL) {
+            seg->ref += k;
+            q->ref_bytes -= k;
+        } else {
+            buffer_consume(wbuf, k);
+            q->sealed -= k;
+        }
+        seg->len -= k;
+        n -= k;
+        if (seg->len == 0) q->head++;
+    }
+    if (q->head == q->count) {
+        q->head = 0;
+        q->count = 0;
+    }
+    // 剩下的属于片段之后追加的 wbuf 数据
+    if (n > 0) buffer_consume(wbuf, n);
+}
+
+int outq_flatten(outq_t *q, buffer_t *wbuf) {
+    if (q->head == q->count) return 0;
+
+    buffer_t flat;
+    buffer_init(&flat);
+    if (buffer_reserve(&flat, outq_pending(q, wbuf)) < 0) return -1;
+
+    struct iovec iov[OUTQ_IOV_MAX];
+    int n;
+    // 片段数超过 OUTQ_IOV_MAX 时分批拷贝
+    while ((n = outq_iov(q, wbuf, iov, OUTQ_IOV_MAX)) > 0) {
+        int bytes = 0;
+        for (int i = 0; i < n; i++) {
+            buffer_append(&flat, iov[i].iov_base, (int)iov[i].iov_len);
+            bytes += (int)iov[i].iov_len;
+        }
+        outq_consume(q, wbuf, bytes);
+    }
+    buffer_free(wbuf);
+    *wbuf = flat;
+    return 0;
+}
+
+void outq_shrink(outq_t *q) {
+    if (q->head == q->count && q->segs != NULL) {
+        outq_free(q);
+    }
+}
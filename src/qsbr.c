@@ -0,0 +1,171 @@
+#include "qsbr.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// 最多登记的线程数，超出的线程按未登记处理
+#define QSBR_THREADS_MAX 512
+// 每个线程挂起列表的初始容量，不够时翻倍
+#define QSBR_RETIRE_INIT 256
+
+struct qsbr_item {
+    void *ptr;
+    qsbr_free_fn fn;
+    uint64_t epoch;     // 交出时的全局纪元
+};
+
+// 每个线程一份，登记时分配，线程退出后也不释放（reactor 线程与进程同寿命）
+// epoch 由所属线程写、回收方读；挂起列表只有所属线程访问，count 允许统计时不加锁读取
+struct qsbr_thread {
+    uint64_t epoch;     // 上线时看到的全局纪元，0 表示下线
+    struct qsbr_item *items;
+    int count;
+    int cap;
+} __attribute__((aligned(64)));
+
+// 全局纪元只在回收时递增，单独占一个缓存行
+static uint64_t global_epoch __attribute__((aligned(64))) = 1;
+
+static struct qsbr_thread *qsbr_threads[QSBR_THREADS_MAX];
+static int qsbr_thread_count = 0;
+static pthread_mutex_t qsbr_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread struct qsbr_thread *qsbr_local = NULL;
+
+int qsbr_register(void) {
+    if (qsbr_local != NULL) return 0;
+    struct qsbr_thread *t = NULL;
+    if (posix_memalign((void **)&t, 64, sizeof(*t)) != 0) return -1;
+    t->epoch = 0;
+    t->items = NULL;
+    t->count = 0;
+    t->cap = 0;
+
+    pthread_mutex_lock(&qsbr_lock);
+    if (qsbr_thread_count >= QSBR_THREADS_MAX) {
+        pthread_mutex_unlock(&qsbr_lock);
+        free(t);
+        return -1;
+    }
+    qsbr_threads[qsbr_thread_count] = t;
+    // 先写好指针再增加计数，回收方看到的条目都是完整的
+    __atomic_store_n(&qsbr_thread_count, qsbr_thread_count + 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&qsbr_lock);
+    qsbr_local = t;
+    return 0;
+}
+
+int qsbr_is_online(void) {
+    return qsbr_local != NULL && qsbr_local->epoch != 0;
+}
+
+// 除 self 以外在线线程的最小纪元，没有在线线程时返回 UINT64_MAX
+static uint64_t qsbr_min_epoch(struct qsbr_thread *self) {
+    uint64_t min = UINT64_MAX;
+    int n = __atomic_load_n(&qsbr_thread_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < n; i++) {
+        struct qsbr_thread *t = qsbr_threads[i];
+        if (t == self) continue;
+        uint64_t e = __atomic_load_n(&t->epoch, __ATOMIC_ACQUIRE);
+        if (e != 0 && e < min) min = e;
+    }
+    return min;
+}
+
+// 推进全局纪元，之后上线的线程都不可能再看到纪元 <= 旧值时交出的内存；
+// 纪元比某一项大的在线线程都是在它被摘下之后才上线的
+static void qsbr_reclaim(struct qsbr_thread *self) {
+    if (self->count == 0) return;
+    __atomic_fetch_add(&global_epoch, 1, __ATOMIC_SEQ_CST);
+    uint64_t min = qsbr_min_epoch(self);
+
+    int kept = 0;
+    for (int i = 0; i < self->count; i++) {
+        struct qsbr_item *it = &self->items[i];
+        if (it->epoch < min) {
+            it->fn(it->ptr);
+        } else {
+            self->items[kept++] = *it;
+        }
+    }
+    __atomic_store_n(&self->count, kept, __ATOMIC_RELAXED);
+}
+
+// 同步等待宽限期：直到除 self 以外的每个线程都下线过或者在纪元 epoch 之后重新上线
+static void qsbr_synchronize(struct qsbr_thread *self, uint64_t epoch) {
+    __atomic_fetch_add(&global_epoch, 1, __ATOMIC_SEQ_CST);
+    int n = __atomic_load_n(&qsbr_thread_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < n; i++) {
+        struct qsbr_thread *t = qsbr_threads[i];
+        if (t == self) continue;
+        for (;;) {
+            uint64_t e = __atomic_load_n(&t->epoch, __ATOMIC_ACQUIRE);
+            if (e == 0 || e > epoch) break;
+            sched_yield();
+        }
+    }
+}
+
+void qsbr_online(void) {
+    struct qsbr_thread *t = qsbr_local;
+    if (t == NULL) return;
+    __atomic_store_n(&t->epoch, __atomic_load_n(&global_epoch, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+    // 和 qsbr_retire 中的栅栏配对：要么回收方看到本线程上线，要么本线程看不到已经摘下的指针
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void qsbr_offline(void) {
+    struct qsbr_thread *t = qsbr_local;
+    if (t == NULL) return;
+    // release：之前对共享数据的读取都发生在回收方看到下线之前
+    __atomic_store_n(&t->epoch, 0, __ATOMIC_RELEASE);
+    qsbr_reclaim(t);
+}
+
+void qsbr_quiescent(void) {
+    qsbr_offline();
+    qsbr_online();
+}
+
+void qsbr_retire(void *ptr, qsbr_free_fn fn) {
+    if (ptr == NULL) return;
+    // 摘下指针的写入要先于读取纪元被其他线程看到
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    uint64_t epoch = __atomic_load_n(&global_epoch, __ATOMIC_ACQUIRE);
+
+    struct qsbr_thread *t = qsbr_local;
+    if (t == NULL) {
+        qsbr_synchronize(NULL, epoch);
+        fn(ptr);
+        return;
+    }
+
+    if (t->count == t->cap) {
+        int cap = t->cap ? t->cap * 2 : QSBR_RETIRE_INIT;
+        struct qsbr_item *items = (struct qsbr_item *)realloc(t->items, cap * sizeof(*items));
+        if (items == NULL) {
+            // 挂不上就暂时下线，同步等完宽限期直接释放（下线期间不会和其他同步中的线程互相等待）
+            uint64_t saved = t->epoch;
+            __atomic_store_n(&t->epoch, 0, __ATOMIC_RELEASE);
+            qsbr_synchronize(t, epoch);
+            fn(ptr);
+            if (saved != 0) qsbr_online();
+            return;
+        }
+        t->items = items;
+        t->cap = cap;
+    }
+    t->items[t->count].ptr = ptr;
+    t->items[t->count].fn = fn;
+    t->items[t->count].epoch = epoch;
+    __atomic_store_n(&t->count, t->count + 1, __ATOMIC_RELAXED);
+}
+
+long qsbr_pending(void) {
+    long total = 0;
+    int n = __atomic_load_n(&qsbr_thread_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < n; i++) {
+        total += __atomic_load_n(&qsbr_threads[i]->count, __ATOMIC_RELAXED);
+    }
+    return total;
+}
@@ -1,195 +1,464 @@
-#include "server.h"
+#define _GNU_SOURCE  // accept4
+#include "reactor.h"
 #include "logger.h"
+#include "stats.h"
+#include "clock.h"
+#include "qsbr.h"
 #include <sys/epoll.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
 
-// 单机最大连接数上限（用于分配 conn_list 大小）
-#define CONN_MAX 1000000
-// 支持监听的最大端口数量（reactor_mainloop 启动时使用）
-#define PORT_MAX 100
-// 每累计 N 个新连接打印一次聚合统计
-#define LOG_CONN_EVERY 10000
-// 每累计 N 个请求打印一次聚合统计
-#define LOG_REQ_EVERY 100000
 // epoll_wait 每轮最多返回的事件条目
 #define MAX_EVENTS 8192
 
-// 使用动态分配以避免静态数组过大导致链接失败
-struct conn **conn_list = NULL;
-int epfd = 0;
+static struct reactor reactors[REACTOR_MAX];
+static int reactor_count = 0;
+struct reactor_options global_opts;
+// 当前线程所属的 reactor，回调签名只有 fd，通过线程局部变量找到自己的状态
+static __thread struct reactor *cur_reactor = NULL;
 static msg_handler global_handler = NULL;
-
-// 性能统计
-static struct {
-    long long total_connections;   // 累计连接数
-    long long active_connections;  // 当前活跃连接数
-    long long total_requests;      // 累计请求数
-    long long total_bytes_recv;    // 累计接收字节数
-    long long total_bytes_sent;    // 累计发送字节数
-} server_stats = {0};
+// 上一次打印统计时的连接总数和时间，用于计算建连速率
+static long long stats_last_connections = 0;
+static long long stats_last_ms;
+// 启动时间，用于计算运行时长
+static long long stats_start_ms;
 
 // 函数声明
 int accept_cb(int fd);
 int recv_cb(int fd);
 int send_cb(int fd);
-void print_stats();
+int recv_et_cb(int fd);
+int send_et_cb(int fd);
 
 // NOTE:
-//  reactor基于EPOLL实现
+//  reactor默认基于EPOLL实现，可选 io_uring 后端（见 reactor_uring.c）
+
+void reactor_set_current(struct reactor *r) {
+    cur_reactor = r;
+}
+
+void reactor_options_init(struct reactor_options *opts) {
+    if (opts == NULL) return;
+    memset(opts, 0, sizeof(*opts));
+    opts->threads = 1;
+    opts->accept_batch = ACCEPT_BATCH_DEFAULT;
+    opts->write_through = 1;
+}
 
 // 设置EPOLL事件
 int set_epoll_event(int fd, int event, int isAdd){
+    struct reactor *r = cur_reactor;
     struct epoll_event ev;
     ev.events = event; // 设置要监控的事件类型
     ev.data.fd = fd;
-    log_debug("set_epoll_event: epfd=%d, fd=%d, event=0x%x, %s", 
-              epfd, fd, event, isAdd ? "ADD" : "MOD");
-    
-    int ret = epoll_ctl(epfd, isAdd ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev);
+    log_debug("set_epoll_event: epfd=%d, fd=%d, event=0x%x, %s",
+              r->epfd, fd, event, isAdd ? "ADD" : "MOD");
+
+    int ret = epoll_ctl(r->epfd, isAdd ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev);
     if(ret < 0) {
         log_error("epoll_ctl failed: fd=%d, errno=%d (%s)", fd, errno, strerror(errno));
     }
     return ret;
 }
 
+// ----- 连接对象池 -----
+
+// 申请 n 个连接对象（一个 slab）挂到空闲链表
+static int conn_pool_grow(struct conn_pool *p, int n) {
+    if (p->slab_count == p->slab_cap) {
+        int cap = p->slab_cap ? p->slab_cap * 2 : 64;
+        void **slabs = (void **)realloc(p->slabs, sizeof(void *) * cap);
+        if (slabs == NULL) return -1;
+        p->slabs = slabs;
+        p->slab_cap = cap;
+    }
+    struct conn *slab = (struct conn *)calloc(n, sizeof(struct conn));
+    if (slab == NULL) return -1;
+    p->slabs[p->slab_count++] = slab;
+    // 倒序入链，出链时按地址顺序使用
+    for (int i = n - 1; i >= 0; i--) {
+        slab[i].next_free = p->free_list;
+        p->free_list = &slab[i];
+    }
+    STAT_ADD(p->free_count, n);
+    STAT_ADD(p->total, n);
+    return 0;
+}
+
+// 取一个清零的连接对象
+static struct conn *conn_pool_get(struct reactor *r) {
+    struct conn_pool *p = &r->pool;
+    if (p->free_list != NULL) {
+        STAT_INC(r->stats.conn_pool_hits);
+    } else {
+        STAT_INC(r->stats.conn_pool_misses);
+        if (conn_pool_grow(p, CONN_SLAB_SIZE) != 0) {
+            log_error("Reactor %d: failed to grow connection pool", r->id);
+            return NULL;
+        }
+    }
+    struct conn *c = p->free_list;
+    p->free_list = c->next_free;
+    STAT_ADD(p->free_count, -1);
+    memset(c, 0, sizeof(*c));
+    return c;
+}
+
+static void conn_pool_put(struct reactor *r, struct conn *c) {
+    c->next_free = r->pool.free_list;
+    r->pool.free_list = c;
+    STAT_INC(r->pool.free_count);
+}
+
+// 初始化连接数据
+struct conn *conn_create(struct reactor *r, int fd) {
+    if (fd < 0 || fd >= CONN_MAX) return NULL;
+    if (!r->conn_list[fd]) {
+        r->conn_list[fd] = conn_pool_get(r);
+        if (!r->conn_list[fd]) return NULL;
+    }
+    struct conn *c = r->conn_list[fd];
+    c->fd = fd;
+    if (global_opts.edge_triggered) {
+        c->action_cb.recv_cb = recv_et_cb;
+        c->send_cb = send_et_cb;
+    } else {
+        c->action_cb.recv_cb = recv_cb;
+        c->send_cb = send_cb;
+    }
+    buffer_clear(&c->rbuf);
+    buffer_clear(&c->wbuf);
+    outq_free(&c->outq);
+    c->read_pending = 0;
+    c->parse_pos = 0;
+    c->ws_frame_len = 0;
+    return c;
+}
+
 // 初始化连接数据并注册EPOLL
 int event_register(int fd, int event) {
-    if (fd < 0 || fd >= CONN_MAX) return -1;
-    if (!conn_list[fd]) {
-        conn_list[fd] = (struct conn*)malloc(sizeof(struct conn));
-        if (!conn_list[fd]) return -1;
-        memset(conn_list[fd], 0, sizeof(struct conn));
-    }
-    conn_list[fd]->fd = fd;
-    conn_list[fd]->action_cb.recv_cb = recv_cb;
-    conn_list[fd]->send_cb = send_cb;
-    memset(conn_list[fd]->rbuff, 0, BUF_LEN);
-    conn_list[fd]->rbuff_len = 0;
-    memset(conn_list[fd]->wbuff, 0, BUF_LEN);
-    conn_list[fd]->wbuff_len = 0;
+    if (conn_create(cur_reactor, fd) == NULL) return -1;
     set_epoll_event(fd, event, 1);
     return 0;
 }
 
-// ----- 回调函数 -----
+// 释放连接数据及其缓冲区（fd 已经关闭）
+void conn_release(struct reactor *r, int fd) {
+    struct conn *c = r->conn_list[fd];
+    STAT_ADD(r->stats.active_connections, -1);
+    if (c != NULL) {
+        timer_del(&r->timers, &c->timer);
+        buffer_free(&c->rbuf);
+        buffer_free(&c->wbuf);
+        outq_free(&c->outq);
+        conn_pool_put(r, c);
+    }
+    r->conn_list[fd] = NULL;
+}
 
-int accept_cb(int fd){
-    struct sockaddr_in client_addr;
-    socklen_t client_addr_len = sizeof(client_addr);
-    // fd是监听套接字，client_fd是客户端套接字
-    int client_fd = accept(fd, (struct sockaddr*)&client_addr, &client_addr_len);
-    if(client_fd < 0) {
-        log_error("accept failed: %s", strerror(errno));
-        return -1;
+// 关闭连接并释放连接数据
+void close_conn(int fd) {
+    struct reactor *r = cur_reactor;
+    if (r->epfd >= 0) {
+        epoll_ctl(r->epfd, EPOLL_CTL_DEL, fd, NULL);
     }
-    
-    char client_ip[INET_ADDRSTRLEN];
-    inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
-    
-    // event_register中设置了回调函数
-    if (event_register(client_fd, EPOLLIN) != 0) {
-        log_error("event_register failed: client_fd=%d out of range", client_fd);
-        close(client_fd);
-        return -1;
+    close(fd);
+    conn_release(r, fd);
+}
+
+// 一轮收发结束后归还已经清空的缓冲区，空闲连接不占缓冲内存
+static void conn_shrink_buffers(struct conn *c) {
+    buffer_shrink(&c->rbuf);
+    buffer_shrink(&c->wbuf);
+    outq_shrink(&c->outq);
+}
+
+// 待发送的字节数（wbuf + 引用片段）
+static inline int conn_out_pending(struct conn *c) {
+    return outq_pending(&c->outq, &c->wbuf);
+}
+
+// 发送一次待发送数据，有引用片段时用 sendmsg 一次发出多段，返回值同 write
+// flags 传 MSG_DONTWAIT 时即使套接字是阻塞的也不会卡住，内核缓冲区满时返回 EAGAIN
+static int conn_write(struct conn *c, int flags) {
+    uint64_t t0 = lat_now();
+    int n;
+    if (c->outq.count == 0) {
+        n = send(c->fd, buffer_peek(&c->wbuf), buffer_len(&c->wbuf), flags);
+    } else {
+        struct iovec iov[OUTQ_IOV_MAX];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = outq_iov(&c->outq, &c->wbuf, iov, OUTQ_IOV_MAX);
+        n = sendmsg(c->fd, &msg, flags);
     }
-    
-    server_stats.total_connections++;
-    server_stats.active_connections++;
-    if (server_stats.total_connections % LOG_CONN_EVERY == 0) {
-        print_stats();
+    lat_record(LAT_SEND, t0);
+    return n;
+}
+
+// 读一次数据追加到 rbuf，返回值同 read
+static int conn_read(struct conn *c) {
+    uint64_t t0 = lat_now();
+    int n = buffer_read_fd(&c->rbuf, c->fd);
+    lat_record(LAT_RECV, t0);
+    return n;
+}
+
+// ----- 超时 -----
+
+enum { CONN_STAGE_IDLE, CONN_STAGE_READ, CONN_STAGE_WRITE };
+
+static inline const char *conn_stage_name(int stage) {
+    switch (stage) {
+        case CONN_STAGE_WRITE: return "write";
+        case CONN_STAGE_READ:  return "read";
+        default:               return "idle";
     }
+}
 
-    return 0;
+// 有响应没发完算写阶段，rbuf 里有不完整的请求算读阶段，否则是空闲
+static int conn_stage(struct conn *c) {
+    if (conn_out_pending(c) > 0) return CONN_STAGE_WRITE;
+    if (buffer_len(&c->rbuf) > 0) return CONN_STAGE_READ;
+    return CONN_STAGE_IDLE;
 }
 
-// NOTE: 通过业务逻辑函数 handler / encode 和收发函数 recv_cb / send_cb 分开实现解耦
+static void conn_timeout_cb(void *arg) {
+    struct reactor *r = cur_reactor;
+    struct conn *c = (struct conn *)arg;
+    STAT_INC(r->stats.timeouts);
+    log_info("Connection timed out (fd=%d, %s)", c->fd, conn_stage_name(conn_stage(c)));
+    if (r->epfd >= 0) {
+        close_conn(c->fd);
+    } else {
+        // io_uring 后端：连接上总有挂起的 recv 或 send，shutdown 让它们立即完成，由完成事件关闭连接
+        shutdown(c->fd, SHUT_RDWR);
+    }
+}
 
-int recv_cb(int fd){
-    if (!conn_list[fd]) return -1;
-    memset(conn_list[fd]->rbuff, 0, BUF_LEN);
-    conn_list[fd]->rbuff_len = read(fd, conn_list[fd]->rbuff, BUF_LEN);
-    if(conn_list[fd]->rbuff_len == 0) {
-        log_info("Client disconnected (fd=%d)", fd);
-        close(fd);
-        epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
-        server_stats.active_connections--;
-        free(conn_list[fd]);
-        conn_list[fd] = NULL;
-        return 0;
+void conn_update_timer(struct reactor *r, struct conn *c) {
+    const struct conn_timeouts *t = &global_opts.timeouts[c->protocol];
+    int ms;
+    switch (conn_stage(c)) {
+        case CONN_STAGE_WRITE: ms = t->write_ms; break;
+        case CONN_STAGE_READ:  ms = t->read_ms;  break;
+        default:               ms = t->idle_ms;  break;
     }
-    else if(conn_list[fd]->rbuff_len < 0) {
-        log_error("Read failed (fd=%d): %s", fd, strerror(errno));
-        close(fd);
-        epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
-        server_stats.active_connections--;
-        free(conn_list[fd]);
-        conn_list[fd] = NULL;
-        return -1;
+    if (ms > 0) {
+        timer_add(&r->timers, &c->timer, ms, conn_timeout_cb, c);
+    } else {
+        timer_del(&r->timers, &c->timer);
     }
-    
-    
-    server_stats.total_bytes_recv += conn_list[fd]->rbuff_len;
-    server_stats.total_requests++;
-    if (server_stats.total_requests % LOG_REQ_EVERY == 0) {
-        print_stats();
+}
+
+// ----- 定时任务 -----
+
+struct reactor_timer {
+    timer_node_t node;
+    int interval_ms;
+    reactor_timer_fn fn;
+    void *arg;
+    int running;    // 正在执行回调
+    int cancelled;  // 回调执行期间被取消
+};
+
+static void reactor_timer_fire(void *arg) {
+    struct reactor_timer *t = (struct reactor_timer *)arg;
+    t->running = 1;
+    t->fn(t->arg);
+    t->running = 0;
+    if (!t->cancelled && t->interval_ms > 0) {
+        timer_add(&cur_reactor->timers, &t->node, t->interval_ms, reactor_timer_fire, t);
+    } else {
+        free(t);
+    }
+}
+
+struct reactor_timer *reactor_timer_add(int delay_ms, int interval_ms, reactor_timer_fn fn, void *arg) {
+    if (cur_reactor == NULL || fn == NULL) return NULL;
+    struct reactor_timer *t = (struct reactor_timer *)calloc(1, sizeof(struct reactor_timer));
+    if (t == NULL) return NULL;
+    t->interval_ms = interval_ms;
+    t->fn = fn;
+    t->arg = arg;
+    timer_add(&cur_reactor->timers, &t->node, delay_ms, reactor_timer_fire, t);
+    return t;
+}
+
+void reactor_timer_cancel(struct reactor_timer *t) {
+    if (t == NULL) return;
+    if (t->running) {
+        t->cancelled = 1;
+        return;
+    }
+    timer_del(&cur_reactor->timers, &t->node);
+    free(t);
+}
+
+// ----- 回调函数 -----
+
+// 监听套接字是非阻塞的，一次唤醒循环 accept 直到积压队列为空或用完 accept_batch 预算
+// 预算用完但队列里还有连接时，水平触发的 epoll 会在下一轮继续通知，不会丢连接
+// 返回本次接受的连接数
+int accept_cb(int fd){
+    struct reactor *r = cur_reactor;
+    int accepted = 0;
+    STAT_INC(r->stats.accept_wakeups);
+
+    while (accepted < global_opts.accept_batch) {
+        // fd是监听套接字，client_fd是客户端套接字
+        // 边缘触发模式下客户端套接字必须是非阻塞的，否则读到 EAGAIN 之前会卡住整个 reactor
+        int client_fd = accept4(fd, NULL, NULL, global_opts.edge_triggered ? SOCK_NONBLOCK : 0);
+        if(client_fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                log_error("accept failed: %s", strerror(errno));
+            }
+            break;
+        }
+
+        // event_register中设置了回调函数
+        int events = global_opts.edge_triggered ? (EPOLLIN | EPOLLOUT | EPOLLET) : EPOLLIN;
+        if (event_register(client_fd, events) != 0) {
+            log_error("event_register failed: client_fd=%d out of range", client_fd);
+            close(client_fd);
+            continue;
+        }
+        conn_update_timer(r, r->conn_list[client_fd]);
+        accepted++;
+
+        STAT_INC(r->stats.total_connections);
+        STAT_INC(r->stats.active_connections);
+        if (r->stats.total_connections % LOG_CONN_EVERY == 0) {
+            print_stats();
+        }
     }
-    // NOTE: 不需要清除conn_list[fd]中的数据，因为fd被重新分配后会覆盖
 
-    // 清空写缓冲区
-    memset(conn_list[fd]->wbuff, 0, BUF_LEN);
-    conn_list[fd]->wbuff_len = 0;
+    return accepted;
+}
+
+// NOTE: 通过业务逻辑函数 handler / encode 和收发函数 recv_cb / send_cb 分开实现解耦
+
+// rbuf 中已有新读到的数据：更新统计并调用业务处理函数，响应追加到 wbuf
+// 返回待发送长度；handler 出错时关闭连接并返回负数，调用方不能再访问 c
+int process_request(struct reactor *r, struct conn *c) {
+    int fd = c->fd;
+    STAT_INC(r->stats.total_requests);
+    if (r->stats.total_requests % LOG_REQ_EVERY == 0) {
+        print_stats();
+    }
 
     if (global_handler != NULL) {
-        int ret = global_handler(conn_list[fd]);
+        // 协议处理的耗时扣掉其中命令执行的部分，分别计入 parse 和 exec
+        uint64_t t0 = lat_now();
+        uint64_t exec0 = lat_exec_total();
+        int ret = global_handler(c);
+        if (t0 != 0) {
+            uint64_t total = lat_now() - t0;
+            uint64_t exec = lat_exec_total() - exec0;
+            lat_record_ns(LAT_PARSE, total > exec ? total - exec : 0);
+        }
         if (ret < 0) {
             log_error("Handler returned error (fd=%d, ret=%d)", fd, ret);
-            close(fd);
-            epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
-            server_stats.active_connections--;
-            free(conn_list[fd]);
-            conn_list[fd] = NULL;
+            close_conn(fd);
             return ret;
         }
-        conn_list[fd]->wbuff_len = ret;
     } else {
         log_warn("No message handler registered, skip processing (fd=%d)", fd);
+        buffer_clear(&c->rbuf);
     }
+    return conn_out_pending(c);
+}
 
-    if (conn_list[fd]->wbuff_len > 0) {
+// 写直通：响应生成后立即用 MSG_DONTWAIT 尝试发送，一次发完就不必切换到 EPOLLOUT 再切回 EPOLLIN，
+// 省掉两次 epoll_ctl 和一轮 epoll_wait；只有内核发送缓冲区满、发不完时才注册 EPOLLOUT 由 send_cb 继续
+// 返回本次发送的字节数，出错时关闭连接并返回 -1
+static int write_through(struct reactor *r, struct conn *c) {
+    int fd = c->fd;
+    int sent = 0;
+    while (conn_out_pending(c) > 0) {
+        int n = conn_write(c, MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            log_error("Write failed (fd=%d): %s", fd, strerror(errno));
+            close_conn(fd);
+            return -1;
+        }
+        STAT_ADD(r->stats.total_bytes_sent, n);
+        outq_consume(&c->outq, &c->wbuf, n);
+        sent += n;
+    }
+
+    if (conn_out_pending(c) > 0) {
+        STAT_INC(r->stats.write_deferred);
         set_epoll_event(fd, EPOLLOUT, 0);
+        return sent;
+    }
+    STAT_INC(r->stats.write_fast_path);
+    if (c->should_close) {
+        close_conn(fd);
+    } else {
+        conn_shrink_buffers(c);
     }
-    return conn_list[fd]->wbuff_len;
+    return sent;
 }
 
-int send_cb(int fd){
-    // 发送数据到客户端 -----
-    if (!conn_list[fd]) return -1;
-    if(conn_list[fd]->wbuff_len == 0) {
-        log_warn("Client closed before sending data (fd=%d)", fd);
-        close(fd);
-        epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
-        server_stats.active_connections--;
-        free(conn_list[fd]);
-        conn_list[fd] = NULL;
+int recv_cb(int fd){
+    struct reactor *r = cur_reactor;
+    struct conn *c = r->conn_list[fd];
+    if (!c) return -1;
+    int n = conn_read(c);
+    if(n == 0) {
+        log_ratelimited(LOG_LEVEL_INFO, LOG_DISCONNECT_INTERVAL_MS, "Client disconnected (fd=%d)", fd);
+        close_conn(fd);
         return 0;
     }
+    else if(n < 0) {
+        log_error("Read failed (fd=%d): %s", fd, strerror(errno));
+        close_conn(fd);
+        return -1;
+    }
+    STAT_ADD(r->stats.total_bytes_recv, n);
+
+    int ret = process_request(r, c);
+    if (ret < 0) {
+        return ret;
+    }
 
-    int remain = conn_list[fd]->wbuff_len - conn_list[fd]->wbuff_sent;
+    if (ret > 0) {
+        if (global_opts.write_through) {
+            return write_through(r, c);
+        }
+        set_epoll_event(fd, EPOLLOUT, 0);
+    } else {
+        conn_shrink_buffers(c);
+    }
+    return ret;
+}
+
+int send_cb(int fd){
+    // 发送数据到客户端 -----
+    struct reactor *r = cur_reactor;
+    struct conn *c = r->conn_list[fd];
+    if (!c) return -1;
+    int remain = conn_out_pending(c);
     if(remain <= 0){ // if 发送完毕
-        if(conn_list[fd]->should_close){
+        if(c->should_close){
             // 关闭连接
-            close(fd);
-            epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
-            server_stats.active_connections--;
-            free(conn_list[fd]);
-            conn_list[fd] = NULL;
+            close_conn(fd);
             return 0;
         } else {
             // 继续监听可读事件
@@ -198,40 +467,135 @@ int send_cb(int fd){
         }
     }
 
-    int writeed_len = write(fd, conn_list[fd]->wbuff + conn_list[fd]->wbuff_sent, remain);
+    // 水平触发模式下客户端套接字是阻塞的，EPOLLOUT 只保证有一点空间；必须用 MSG_DONTWAIT，
+    // 否则对端不读时 send 会卡住整个 reactor，写超时也没有机会触发
+    int writeed_len = conn_write(c, MSG_DONTWAIT);
+    if(writeed_len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        // 缓冲区又满了，保持写状态等下一次 EPOLLOUT
+        return 0;
+    }
     if(writeed_len < 0) { // if 写入出错
         log_error("Write failed (fd=%d): %s", fd, strerror(errno));
-        close(fd);
-        epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
-        server_stats.active_connections--;
-        free(conn_list[fd]);
-        conn_list[fd] = NULL;
+        close_conn(fd);
         return -1;
     }
-    server_stats.total_bytes_sent += writeed_len;
-    conn_list[fd]->wbuff_sent += writeed_len;
+    STAT_ADD(r->stats.total_bytes_sent, writeed_len);
+    outq_consume(&c->outq, &c->wbuf, writeed_len);
 
     // 如果还有剩余，继续保持写状态
-    if(conn_list[fd]->wbuff_sent < conn_list[fd]->wbuff_len){
-        set_epoll_event(fd, EPOLLOUT, 0);
+    if(conn_out_pending(c) > 0){
         return writeed_len;
     }
 
-    if(conn_list[fd]->should_close){
-        close(fd);
-        epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
-        server_stats.active_connections--;
-        free(conn_list[fd]);
-        conn_list[fd] = NULL;
+    if(c->should_close){
+        close_conn(fd);
         return writeed_len;
     } else {
+        conn_shrink_buffers(c);
         set_epoll_event(fd, EPOLLIN, 0);
         return writeed_len;
     }
 }
 
+// ----- 边缘触发（EPOLLET）模式 -----
+// 客户端套接字为非阻塞，注册一次 EPOLLIN | EPOLLOUT | EPOLLET 后不再 epoll_ctl 修改：
+//   - 可读时循环 read 直到 EAGAIN，每读到一块就处理并立即尝试写回
+//   - 写到 EAGAIN 时停止读取（数据留在内核缓冲区），等待下一次 EPOLLOUT 边沿写完剩余数据后再继续读
+// 这样一个流水线连接在一次唤醒内就能处理完，而不是每读一次就 epoll_wait 一次
+
+// 非阻塞地尽量发送 wbuf 中的剩余数据
+// 返回 1=发送完毕, 0=内核缓冲区已满, -1=出错（连接已关闭）
+static int flush_wbuf(struct reactor *r, struct conn *c) {
+    while (conn_out_pending(c) > 0) {
+        int n = conn_write(c, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            log_error("Write failed (fd=%d): %s", c->fd, strerror(errno));
+            close_conn(c->fd);
+            return -1;
+        }
+        STAT_ADD(r->stats.total_bytes_sent, n);
+        outq_consume(&c->outq, &c->wbuf, n);
+    }
+    return 1;
+}
+
+int recv_et_cb(int fd){
+    struct reactor *r = cur_reactor;
+    struct conn *c = r->conn_list[fd];
+    if (!c) return -1;
+
+    while (1) {
+        // 上一个响应还没发完，先不读，等 EPOLLOUT 边沿发完后由 send_et_cb 继续
+        if (conn_out_pending(c) > 0) {
+            c->read_pending = 1;
+            return 0;
+        }
+
+        int n = conn_read(c);
+        if (n == 0) {
+            log_ratelimited(LOG_LEVEL_INFO, LOG_DISCONNECT_INTERVAL_MS, "Client disconnected (fd=%d)", fd);
+            close_conn(fd);
+            return 0;
+        } else if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                conn_shrink_buffers(c);
+                return 0;  // 已读空，等待下一次 EPOLLIN 边沿
+            }
+            log_error("Read failed (fd=%d): %s", fd, strerror(errno));
+            close_conn(fd);
+            return -1;
+        }
+        STAT_ADD(r->stats.total_bytes_recv, n);
+
+        int pending = process_request(r, c);
+        if (pending < 0) {
+            return -1;
+        }
+
+        int ret = flush_wbuf(r, c);
+        if (ret < 0) {
+            return -1;
+        }
+        if (pending > 0) {
+            if (ret == 1) STAT_INC(r->stats.write_fast_path);
+            else STAT_INC(r->stats.write_deferred);
+        }
+        if (ret == 1 && c->should_close) {
+            close_conn(fd);
+            return 0;
+        }
+    }
+}
+
+int send_et_cb(int fd){
+    struct reactor *r = cur_reactor;
+    struct conn *c = r->conn_list[fd];
+    if (!c) return -1;
+    // 注册后的第一次 EPOLLOUT 边沿或没有待发送数据时直接忽略
+    if (conn_out_pending(c) == 0) return 0;
+
+    int ret = flush_wbuf(r, c);
+    if (ret <= 0) {
+        return ret;
+    }
+    if (c->should_close) {
+        close_conn(fd);
+        return 0;
+    }
+    // 写完后补上之前因为写阻塞而暂停的读取
+    if (c->read_pending) {
+        c->read_pending = 0;
+        return recv_et_cb(fd);
+    }
+    return 0;
+}
+
 // 打开一个服务器套接字并监听端口，返回套接字fd
-int init_server(unsigned short port){
+// reuseport: 多 reactor 模式下每个线程各自绑定同一端口，由内核在这些套接字间分摊新连接
+int init_server(unsigned short port, int reuseport){
     int sockfd = socket(AF_INET, SOCK_STREAM, 0);
     if(sockfd < 0) {
         log_error("socket creation failed: %s", strerror(errno));
@@ -240,70 +604,213 @@ int init_server(unsigned short port){
     // 设置 SO_REUSEADDR 选项，允许服务器在TIME_WAIT状态下立即重启
     int opt = 1;
     setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (reuseport && setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        log_error("setsockopt SO_REUSEPORT failed on port %d: %s", port, strerror(errno));
+        close(sockfd);
+        return -1;
+    }
 
     struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
     server_addr.sin_family = AF_INET;
     server_addr.sin_port = htons(port);
     server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
     if(bind(sockfd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
         log_error("bind failed on port %d: %s", port, strerror(errno));
+        close(sockfd);
         return -1;
     }
-    
+
     // NOTICE: 不要使用SOMAXCONN，因为它是一个编译时宏，依赖系统宏通常是错误的开始！！！
     listen(sockfd, 65535);
     return sockfd;
 }
 
-// 打印服务器统计信息
+// 汇总所有 reactor 的计数器，可以在任意线程调用
+static void stats_collect(struct server_stats *sum, long long *pool_total, long long *pool_free) {
+    memset(sum, 0, sizeof(*sum));
+    *pool_total = 0;
+    *pool_free = 0;
+    int n = __atomic_load_n(&reactor_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < n; i++) {
+        struct server_stats *s = &reactors[i].stats;
+        sum->total_connections  += STAT_GET(s->total_connections);
+        sum->active_connections += STAT_GET(s->active_connections);
+        sum->total_requests     += STAT_GET(s->total_requests);
+        sum->total_bytes_recv   += STAT_GET(s->total_bytes_recv);
+        sum->total_bytes_sent   += STAT_GET(s->total_bytes_sent);
+        sum->conn_pool_hits     += STAT_GET(s->conn_pool_hits);
+        sum->conn_pool_misses   += STAT_GET(s->conn_pool_misses);
+        sum->accept_wakeups     += STAT_GET(s->accept_wakeups);
+        sum->write_fast_path    += STAT_GET(s->write_fast_path);
+        sum->write_deferred     += STAT_GET(s->write_deferred);
+        sum->timeouts           += STAT_GET(s->timeouts);
+        *pool_total += STAT_GET(reactors[i].pool.total);
+        *pool_free  += STAT_GET(reactors[i].pool.free_count);
+    }
+}
+
+// 打印服务器统计信息（汇总所有 reactor）
 void print_stats() {
+    struct server_stats sum;
+    long long pool_total, pool_free;
+    stats_collect(&sum, &pool_total, &pool_free);
+
     log_info("=== Server Statistics ===");
-    log_info("Total Connections: %lld", server_stats.total_connections);
-    log_info("Active Connections: %lld", server_stats.active_connections);
-    log_info("Total Requests: %lld", server_stats.total_requests);
-    log_info("Total Bytes Recv: %lld (%.2f MB)", 
-               server_stats.total_bytes_recv, 
-               server_stats.total_bytes_recv / 1048576.0);
-    log_info("Total Bytes Sent: %lld (%.2f MB)", 
-               server_stats.total_bytes_sent,
-               server_stats.total_bytes_sent / 1048576.0);
-    if (server_stats.total_requests > 0) {
-        log_info("Avg Request Size: %.2f bytes", 
-                   (double)server_stats.total_bytes_recv / server_stats.total_requests);
+    log_info("Reactors: %d", reactor_count);
+    log_info("Total Connections: %lld", sum.total_connections);
+    log_info("Active Connections: %lld", sum.active_connections);
+    log_info("Total Requests: %lld", sum.total_requests);
+    log_info("Total Bytes Recv: %lld (%.2f MB)",
+               sum.total_bytes_recv,
+               sum.total_bytes_recv / 1048576.0);
+    log_info("Total Bytes Sent: %lld (%.2f MB)",
+               sum.total_bytes_sent,
+               sum.total_bytes_sent / 1048576.0);
+    if (sum.total_requests > 0) {
+        log_info("Avg Request Size: %.2f bytes",
+                   (double)sum.total_bytes_recv / sum.total_requests);
         log_info("Avg Response Size: %.2f bytes",
-                   (double)server_stats.total_bytes_sent / server_stats.total_requests);
+                   (double)sum.total_bytes_sent / sum.total_requests);
+    }
+    log_info("Conn Pool: hits=%lld misses=%lld allocated=%lld free=%lld",
+             sum.conn_pool_hits, sum.conn_pool_misses, pool_total, pool_free);
+
+    long long now = clock_mono_ms();
+    double elapsed = (now - stats_last_ms) / 1e3;
+    if (elapsed > 0) {
+        log_info("Accept Rate: %.0f conn/s", (sum.total_connections - stats_last_connections) / elapsed);
     }
+    stats_last_ms = now;
+    stats_last_connections = sum.total_connections;
+    if (sum.accept_wakeups > 0) {
+        log_info("Accept Batch: budget=%d, wakeups=%lld, avg=%.2f conn/wakeup",
+                 global_opts.accept_batch, sum.accept_wakeups,
+                 (double)sum.total_connections / sum.accept_wakeups);
+    }
+    if (sum.write_fast_path + sum.write_deferred > 0) {
+        log_info("Write Path: fast=%lld deferred=%lld (%.1f%% fast)",
+                 sum.write_fast_path, sum.write_deferred,
+                 100.0 * sum.write_fast_path / (sum.write_fast_path + sum.write_deferred));
+    }
+    if (sum.timeouts > 0) {
+        log_info("Timed Out Connections: %lld", sum.timeouts);
+    }
+    lat_report();
     log_info("========================");
 }
 
-int reactor_mainloop(unsigned short port_start, int port_count, msg_handler handler){
-    if(port_start < 0 || port_count <= 0){
-        log_error("Invalid port range(%d, %d)", port_start, port_start + port_count);
-        return -1;
+// 进程常驻内存（字节），读取失败返回 0
+static long long rss_bytes(void) {
+    long long pages = 0, resident = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f == NULL) return 0;
+    if (fscanf(f, "%lld %lld", &pages, &resident) != 2) resident = 0;
+    fclose(f);
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+static int info_section_match(const char *section, const char *name) {
+    return section == NULL || strcasecmp(section, "all") == 0 || strcasecmp(section, name) == 0;
+}
+
+int reactor_info(buffer_t *out, const char *section) {
+    struct server_stats sum;
+    long long pool_total, pool_free;
+    stats_collect(&sum, &pool_total, &pool_free);
+    int start = buffer_len(out);
+
+    if (info_section_match(section, "server")) {
+        const char *backend = global_opts.backend == REACTOR_BACKEND_URING ? "io_uring"
+                            : global_opts.edge_triggered ? "epoll-et" : "epoll";
+        buffer_printf(out, "# Server\r\n");
+        buffer_printf(out, "process_id:%d\r\n", (int)getpid());
+        buffer_printf(out, "uptime_in_seconds:%ld\r\n", (long)((clock_mono_ms() - stats_start_ms) / 1000));
+        buffer_printf(out, "reactors:%d\r\n", reactor_count);
+        buffer_printf(out, "io_backend:%s\r\n", backend);
+        buffer_printf(out, "write_through:%d\r\n", global_opts.write_through);
+        buffer_printf(out, "log_level:%s\r\n", log_level_name(log_get_level()));
+        buffer_printf(out, "log_dropped:%llu\r\n", (unsigned long long)logger_dropped());
     }
-    
-    // 动态分配连接数组
-    if (conn_list == NULL) {
-        conn_list = (struct conn**)calloc(CONN_MAX, sizeof(struct conn*));
-        if (conn_list == NULL) {
-            log_error("Failed to allocate memory for connection list");
-            return -1;
-        }
+    if (info_section_match(section, "clients")) {
+        buffer_printf(out, "# Clients\r\n");
+        buffer_printf(out, "connected_clients:%lld\r\n", sum.active_connections);
+        buffer_printf(out, "total_connections_received:%lld\r\n", sum.total_connections);
+        buffer_printf(out, "total_requests_processed:%lld\r\n", sum.total_requests);
+        buffer_printf(out, "total_net_input_bytes:%lld\r\n", sum.total_bytes_recv);
+        buffer_printf(out, "total_net_output_bytes:%lld\r\n", sum.total_bytes_sent);
+        buffer_printf(out, "accept_wakeups:%lld\r\n", sum.accept_wakeups);
+        buffer_printf(out, "write_fast_path:%lld\r\n", sum.write_fast_path);
+        buffer_printf(out, "write_deferred:%lld\r\n", sum.write_deferred);
+        buffer_printf(out, "timed_out_connections:%lld\r\n", sum.timeouts);
+    }
+    if (info_section_match(section, "memory")) {
+        buffer_printf(out, "# Memory\r\n");
+        buffer_printf(out, "used_memory_rss:%lld\r\n", rss_bytes());
+        buffer_printf(out, "conn_object_size:%d\r\n", (int)sizeof(struct conn));
+        buffer_printf(out, "conn_pool_allocated:%lld\r\n", pool_total);
+        buffer_printf(out, "conn_pool_free:%lld\r\n", pool_free);
+        buffer_printf(out, "conn_pool_hits:%lld\r\n", sum.conn_pool_hits);
+        buffer_printf(out, "conn_pool_misses:%lld\r\n", sum.conn_pool_misses);
     }
+    return buffer_len(out) - start;
+}
 
-    global_handler = handler;
+int reactor_metrics(buffer_t *out) {
+    struct server_stats sum;
+    long long pool_total, pool_free;
+    stats_collect(&sum, &pool_total, &pool_free);
+    int start = buffer_len(out);
 
-    epfd = epoll_create(1);
-    if(epfd < 0) {
-        log_error("epoll_create failed: %s", strerror(errno));
+    metrics_value(out, "netlib_reactors", "gauge", "Number of reactor threads", reactor_count);
+    metrics_value(out, "netlib_connections_active", "gauge", "Currently open client connections",
+                  sum.active_connections);
+    metrics_value(out, "netlib_connections_total", "counter", "Accepted client connections",
+                  sum.total_connections);
+    metrics_value(out, "netlib_connection_timeouts_total", "counter",
+                  "Connections closed by idle/read/write timeouts", sum.timeouts);
+    metrics_value(out, "netlib_requests_total", "counter", "Processed read events carrying request data",
+                  sum.total_requests);
+    metrics_value(out, "netlib_net_input_bytes_total", "counter", "Bytes received from clients",
+                  sum.total_bytes_recv);
+    metrics_value(out, "netlib_net_output_bytes_total", "counter", "Bytes sent to clients",
+                  sum.total_bytes_sent);
+    metrics_family(out, "netlib_writes_total", "counter", "Responses flushed inline or deferred to EPOLLOUT");
+    buffer_printf(out, "netlib_writes_total{path=\"fast\"} %lld\n", sum.write_fast_path);
+    buffer_printf(out, "netlib_writes_total{path=\"deferred\"} %lld\n", sum.write_deferred);
+    metrics_family(out, "netlib_conn_pool_objects", "gauge", "Connection objects held by the pools");
+    buffer_printf(out, "netlib_conn_pool_objects{state=\"allocated\"} %lld\n", pool_total);
+    buffer_printf(out, "netlib_conn_pool_objects{state=\"free\"} %lld\n", pool_free);
+    metrics_value(out, "netlib_log_dropped_total", "counter", "Log records dropped because the logger queue was full",
+                  (long long)logger_dropped());
+    metrics_value(out, "process_resident_memory_bytes", "gauge", "Resident memory size in bytes", rss_bytes());
+    return buffer_len(out) - start;
+}
+
+// 初始化一个 reactor：创建连接表，并打开端口范围内的全部监听套接字（I/O 后端由 reactor_mainloop_ex 统一选择）
+static int reactor_init(struct reactor *r, int id, unsigned short port_start, int port_count, int reuseport) {
+    memset(r, 0, sizeof(*r));
+    r->id = id;
+    r->epfd = -1;
+    r->backend = REACTOR_BACKEND_EPOLL;
+    timer_wheel_init(&r->timers, clock_mono_ms());
+
+    // 动态分配连接数组
+    r->conn_list = (struct conn**)calloc(CONN_MAX, sizeof(struct conn*));
+    if (r->conn_list == NULL) {
+        log_error("Failed to allocate memory for connection list");
         return -1;
     }
 
-    
+    // 预分配连接对象，启动后的建连高峰不再走 malloc
+    if (global_opts.conn_prealloc > 0 && conn_pool_grow(&r->pool, global_opts.conn_prealloc) != 0) {
+        log_error("Failed to preallocate %d connections", global_opts.conn_prealloc);
+        return -1;
+    }
 
     int i = 0;
     for(i = 0; i < port_count; i++){
-        int sockfd = init_server(port_start + i);
+        int sockfd = init_server(port_start + i, reuseport);
         if(sockfd < 0){
             log_error("Init server failed on port %d", port_start + i);
             return -1;
@@ -313,30 +820,67 @@ int reactor_mainloop(unsigned short port_start, int port_count, msg_handler hand
             close(sockfd);
             return -1;
         }
-        if (!conn_list[sockfd]) {
-            conn_list[sockfd] = (struct conn*)malloc(sizeof(struct conn));
-            if (!conn_list[sockfd]) {
-                close(sockfd);
+        r->listen_fds[r->listen_count++] = sockfd;
+    }
+    return 0;
+}
+
+// epoll 后端：创建 epoll 并注册监听套接字
+static int reactor_init_epoll(struct reactor *r) {
+    int i = 0;
+    r->backend = REACTOR_BACKEND_EPOLL;
+    r->epfd = epoll_create(1);
+    if(r->epfd < 0) {
+        log_error("epoll_create failed: %s", strerror(errno));
+        return -1;
+    }
+
+    // 监听套接字注册到本 reactor 的 epoll 上
+    struct reactor *saved = cur_reactor;
+    cur_reactor = r;
+    for (i = 0; i < r->listen_count; i++) {
+        int sockfd = r->listen_fds[i];
+        // 批量 accept 需要非阻塞，队列取空时返回 EAGAIN 而不是卡住 reactor
+        fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL, 0) | O_NONBLOCK);
+        if (!r->conn_list[sockfd]) {
+            r->conn_list[sockfd] = conn_pool_get(r);
+            if (!r->conn_list[sockfd]) {
+                cur_reactor = saved;
                 return -1;
             }
-            memset(conn_list[sockfd], 0, sizeof(struct conn));
         }
-        conn_list[sockfd]->fd = sockfd;
-        conn_list[sockfd]->action_cb.accept_cb = accept_cb;
+        r->conn_list[sockfd]->fd = sockfd;
+        r->conn_list[sockfd]->action_cb.accept_cb = accept_cb;
         set_epoll_event(sockfd, EPOLLIN, 1);
     }
-    printf("Server listening on 0.0.0.0:%d-%d (%d ports)\n", port_start, port_start + port_count - 1, port_count);
-    fflush(stdout);
+    cur_reactor = saved;
+    return 0;
+}
+
+// reactor 事件循环，每个线程运行一个
+static void *reactor_run(void *arg) {
+    struct reactor *r = (struct reactor *)arg;
+    cur_reactor = r;
 
     // mainloop
     struct epoll_event *events_buf = (struct epoll_event*)malloc(sizeof(struct epoll_event) * MAX_EVENTS);
     if (!events_buf) {
-        return -1;
+        log_error("Reactor %d: failed to allocate event buffer", r->id);
+        return NULL;
     }
+    // 登记到 QSBR，之后本线程查询哈希引擎不加锁；登记失败时照常加锁查询
+    qsbr_register();
     while(1){
-        int nready = epoll_wait(epfd, events_buf, MAX_EVENTS, -1);
-        
-        
+        // 有定时器时最多睡到下一个到期的 tick
+        int timeout = timer_wheel_timeout(&r->timers, r->timers.now_ms);
+        // 等待事件期间不持有任何存储引擎的指针，对 QSBR 来说是下线状态，其他线程摘下的内存不必等它
+        qsbr_offline();
+        int nready = epoll_wait(r->epfd, events_buf, MAX_EVENTS, timeout);
+        qsbr_online();
+        // 每轮只取一次时间，本轮的日志、统计和超时都读这份缓存
+        clock_update();
+        // 事件回调里设置的超时都以本轮醒来的时间为起点
+        timer_wheel_update(&r->timers, clock_mono_ms());
 
         int i = 0;
         for(i = 0; i < nready; i++){
@@ -344,24 +888,130 @@ int reactor_mainloop(unsigned short port_start, int port_count, msg_handler hand
             if (fd < 0 || fd >= CONN_MAX) {
                 continue;
             }
-            
-            
-            if(events_buf[i].events & EPOLLIN){
+            struct conn **conn_list = r->conn_list;
+
+
+            uint32_t revents = events_buf[i].events;
+            // EPOLLERR/EPOLLHUP 当作可读处理，由 read 返回 0 或错误来关闭连接
+            if(revents & (EPOLLIN | EPOLLERR | EPOLLHUP)){
                 // action_cb是union，用哪个成员名访问都一样
                 // TODO: 优化提升可读性，避免accept和read混淆
                 if(conn_list[fd] && conn_list[fd]->action_cb.accept_cb != NULL){
                     conn_list[fd]->action_cb.accept_cb(fd);
-                    
+
                 } else if (conn_list[fd] && conn_list[fd]->action_cb.recv_cb != NULL) {
                     conn_list[fd]->action_cb.recv_cb(fd);
                 }
             }
-            else if(events_buf[i].events & EPOLLOUT){
+            // 边缘触发模式下同一事件可能同时带有 EPOLLIN 和 EPOLLOUT，两个都要处理
+            // 读回调可能已经关闭连接，这里需要重新检查 conn_list[fd]
+            if(revents & EPOLLOUT){
                 // send_cb是conn结构体的直接成员，不在union中
                 if(conn_list[fd] && conn_list[fd]->send_cb != NULL){
                     conn_list[fd]->send_cb(fd);
                 }
             }
+            // 连接还在就按收发之后的状态重设超时（监听套接字没有 send_cb）
+            if(conn_list[fd] && conn_list[fd]->send_cb != NULL){
+                conn_update_timer(r, conn_list[fd]);
+            }
         }
+        // 到期的定时器放在本批事件之后处理：超时回调关闭的 fd 可能在同一批里被 accept 复用，
+        // 先处理定时器的话，本批中旧连接残留的事件会交给新连接（LT 模式下是阻塞套接字，会卡住 reactor）
+        timer_wheel_advance(&r->timers, clock_mono_ms());
     }
+    return NULL;
+}
+
+int reactor_mainloop_ex(unsigned short port_start, int port_count, msg_handler handler,
+                        const struct reactor_options *opts){
+    if(port_start < 0 || port_count <= 0 || port_count > PORT_MAX){
+        log_error("Invalid port range(%d, %d)", port_start, port_start + port_count);
+        return -1;
+    }
+
+    struct reactor_options defaults;
+    if (opts == NULL) {
+        reactor_options_init(&defaults);
+        opts = &defaults;
+    }
+    int nthreads = opts->threads;
+    if (nthreads <= 0 || nthreads > REACTOR_MAX) {
+        log_error("Invalid reactor thread count: %d (1-%d)", nthreads, REACTOR_MAX);
+        return -1;
+    }
+    if (opts->accept_batch <= 0) {
+        log_error("Invalid accept batch: %d", opts->accept_batch);
+        return -1;
+    }
+    for (int p = 0; p < PROTO_COUNT; p++) {
+        const struct conn_timeouts *t = &opts->timeouts[p];
+        if (t->idle_ms < 0 || t->read_ms < 0 || t->write_ms < 0) {
+            log_error("Invalid timeout for protocol %d", p);
+            return -1;
+        }
+    }
+
+    global_handler = handler;
+    global_opts = *opts;
+    lat_enabled = opts->latency_stats;
+    stats_last_ms = clock_mono_ms();
+    stats_start_ms = stats_last_ms;
+
+    // 所有 reactor 在主线程完成初始化，端口绑定失败可以同步返回错误
+    // 只有多线程时才开启 SO_REUSEPORT，避免单线程下两个进程悄悄绑定到同一端口
+    for (int i = 0; i < nthreads; i++) {
+        if (reactor_init(&reactors[i], i, port_start, port_count, nthreads > 1) != 0) {
+            return -1;
+        }
+        reactor_count++;
+    }
+
+    // 后端对所有 reactor 统一选择：任何一个 io_uring 初始化失败（内核不支持、memlock 不足等）都整体回退到 epoll，
+    // 已经建好的 ring 释放掉。否则建好 ring 的 reactor 没有 epoll 可等，它们的 SO_REUSEPORT 监听套接字却照样分到连接
+    if (global_opts.backend == REACTOR_BACKEND_URING) {
+        for (int i = 0; i < nthreads; i++) {
+            if (uring_reactor_init(&reactors[i]) != 0) {
+                log_warn("Reactor %d: io_uring unavailable, falling back to epoll", i);
+                for (int j = 0; j < i; j++) {
+                    uring_reactor_free(&reactors[j]);
+                }
+                global_opts.backend = REACTOR_BACKEND_EPOLL;
+                break;
+            }
+            reactors[i].backend = REACTOR_BACKEND_URING;
+        }
+    }
+    if (global_opts.backend == REACTOR_BACKEND_EPOLL) {
+        for (int i = 0; i < nthreads; i++) {
+            if (reactor_init_epoll(&reactors[i]) != 0) {
+                return -1;
+            }
+        }
+    }
+    const char *mode = global_opts.backend == REACTOR_BACKEND_URING ? "io_uring"
+                     : global_opts.edge_triggered ? "epoll edge-triggered" : "epoll level-triggered";
+    printf("Server listening on 0.0.0.0:%d-%d (%d ports, %d reactors, %s)\n",
+           port_start, port_start + port_count - 1, port_count, nthreads, mode);
+    fflush(stdout);
+
+    // reactor 0 运行在当前线程，其余各自一个线程，每个线程运行自己初始化时用的后端的事件循环
+    for (int i = 1; i < nthreads; i++) {
+        void *(*run)(void *) = reactors[i].backend == REACTOR_BACKEND_URING ? uring_reactor_run : reactor_run;
+        int err = pthread_create(&reactors[i].tid, NULL, run, &reactors[i]);
+        if (err != 0) {
+            log_error("Failed to start reactor thread %d: %s", i, strerror(err));
+            return -1;
+        }
+    }
+    if (reactors[0].backend == REACTOR_BACKEND_URING) {
+        uring_reactor_run(&reactors[0]);
+    } else {
+        reactor_run(&reactors[0]);
+    }
+    return -1;
+}
+
+int reactor_mainloop(unsigned short port_start, int port_count, msg_handler handler){
+    return reactor_mainloop_ex(port_start, port_count, handler, NULL);
 }
@@ -0,0 +1,491 @@
+#define _GNU_SOURCE
+#include "reactor.h"
+#include "logger.h"
+#include "clock.h"
+#include "qsbr.h"
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <stdint.h>
+
+// NOTE:
+//  io_uring 后端，直接使用系统调用，不依赖 liburing
+//  - 监听套接字使用 multishot accept，一个 SQE 持续产生新连接
+//  - recv 使用 provided buffer ring，内核自己从缓冲池挑选缓冲区，空闲连接不占用读缓冲
+//  - 响应的 send 与下一次 recv（或 close）链接提交，recv→handler→send 一轮只需一次 io_uring_enter
+//  业务层仍然通过 msg_handler 读 rbuf、写 wbuf，协议代码无需任何改动
+
+// SQ 深度
+#define URING_ENTRIES 4096
+// provided buffer 数量（必须是 2 的幂）与大小
+// 单次 recv 最多读 URING_BUF_SIZE 字节，更长的请求分多次 recv 追加到 rbuf
+#define URING_BUF_COUNT 2048
+#define URING_BUF_SIZE 4096
+#define URING_BGID 0
+
+// user_data 编码：高 8 位操作类型 | 中间 24 位连接代数 | 低 32 位 fd
+enum {
+    URING_OP_ACCEPT = 1,
+    URING_OP_RECV   = 2,
+    URING_OP_SEND   = 3,
+    URING_OP_CLOSE  = 4
+};
+
+#define URING_UD(op, gen, fd) (((uint64_t)(op) << 56) | ((uint64_t)((gen) & 0xFFFFFF) << 32) | (uint32_t)(fd))
+#define URING_UD_OP(ud)  ((int)((ud) >> 56))
+#define URING_UD_GEN(ud) ((unsigned int)(((ud) >> 32) & 0xFFFFFF))
+#define URING_UD_FD(ud)  ((int)((ud) & 0xFFFFFFFF))
+
+struct uring_ctx {
+    int ring_fd;
+
+    // 提交队列
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    struct io_uring_sqe *sqes;
+    unsigned sq_local_tail;     // 已填写但尚未发布给内核的尾部
+    unsigned sq_submitted;      // 已经交给 io_uring_enter 的数量
+
+    // 完成队列
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe *cqes;
+
+    // mmap 区域
+    void *sq_ptr;
+    void *cq_ptr;
+    size_t sq_size;
+    size_t cq_size;
+    size_t sqes_size;
+
+    // provided buffer ring
+    struct io_uring_buf_ring *br;
+    size_t br_size;
+    char *bufs;
+    unsigned short br_tail;
+
+    unsigned int gen;           // 连接代数计数器
+};
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags,
+                              void *arg, size_t argsz) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+// 发布本地填写的 SQE 并进入内核；wait_nr > 0 时阻塞等待至少 wait_nr 个完成事件
+// timeout_ms >= 0 时最多等待这么久（定时器到期），-1 表示一直等
+static int uring_submit(struct uring_ctx *u, unsigned wait_nr, int timeout_ms) {
+    __atomic_store_n(u->sq_tail, u->sq_local_tail, __ATOMIC_RELEASE);
+    unsigned to_submit = u->sq_local_tail - u->sq_submitted;
+    if (to_submit == 0 && wait_nr == 0) {
+        return 0;
+    }
+
+    unsigned flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    void *argp = NULL;
+    size_t argsz = 0;
+    if (wait_nr && timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        flags |= IORING_ENTER_EXT_ARG;
+        argp = &arg;
+        argsz = sizeof(arg);
+    }
+    int ret = sys_io_uring_enter(u->ring_fd, to_submit, wait_nr, flags, argp, argsz);
+    if (ret < 0) {
+        if (errno != EINTR && errno != EBUSY && errno != ETIME) {
+            log_error("io_uring_enter failed: %s", strerror(errno));
+        }
+        return -1;
+    }
+    u->sq_submitted += ret;
+    return ret;
+}
+
+// 取一个空闲 SQE，SQ 满时先提交一次腾出空间
+static struct io_uring_sqe *uring_get_sqe(struct uring_ctx *u) {
+    unsigned head = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+    if (u->sq_local_tail - head >= u->sq_entries) {
+        uring_submit(u, 0, -1);
+        head = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+        if (u->sq_local_tail - head >= u->sq_entries) {
+            log_error("io_uring SQ full");
+            return NULL;
+        }
+    }
+    struct io_uring_sqe *sqe = &u->sqes[u->sq_local_tail & u->sq_mask];
+    u->sq_local_tail++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+// 把缓冲区还给 provided buffer ring
+static void uring_buf_recycle(struct uring_ctx *u, unsigned short bid) {
+    struct io_uring_buf *buf = &u->br->bufs[u->br_tail & (URING_BUF_COUNT - 1)];
+    buf->addr = (uint64_t)(uintptr_t)(u->bufs + (size_t)bid * URING_BUF_SIZE);
+    buf->len = URING_BUF_SIZE;
+    buf->bid = bid;
+    u->br_tail++;
+    __atomic_store_n(&u->br->tail, u->br_tail, __ATOMIC_RELEASE);
+}
+
+// ----- SQE 准备 -----
+
+static void uring_prep_accept(struct uring_ctx *u, int lfd) {
+    struct io_uring_sqe *sqe = uring_get_sqe(u);
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = lfd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = URING_UD(URING_OP_ACCEPT, 0, lfd);
+}
+
+static struct io_uring_sqe *uring_prep_recv(struct uring_ctx *u, struct conn *c) {
+    struct io_uring_sqe *sqe = uring_get_sqe(u);
+    if (!sqe) return NULL;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = c->fd;
+    sqe->len = URING_BUF_SIZE;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BGID;
+    sqe->user_data = URING_UD(URING_OP_RECV, c->io_gen, c->fd);
+    return sqe;
+}
+
+// send 与后续操作链接：send 完成后内核才开始下一次 recv（或 close），保证响应顺序
+// MSG_WAITALL 让内核在短写时自行重试；send 失败时链上的后续操作会以 -ECANCELED 完成
+static struct io_uring_sqe *uring_prep_send(struct uring_ctx *u, struct conn *c) {
+    struct io_uring_sqe *sqe = uring_get_sqe(u);
+    if (!sqe) return NULL;
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = c->fd;
+    // 发送完成之前 wbuf 不会被修改：链上的 recv 要等 send 完成后才开始
+    sqe->addr = (uint64_t)(uintptr_t)buffer_peek(&c->wbuf);
+    sqe->len = buffer_len(&c->wbuf);
+    sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+    sqe->flags = IOSQE_IO_LINK;
+    sqe->user_data = URING_UD(URING_OP_SEND, c->io_gen, c->fd);
+    return sqe;
+}
+
+static struct io_uring_sqe *uring_prep_close(struct uring_ctx *u, struct conn *c) {
+    struct io_uring_sqe *sqe = uring_get_sqe(u);
+    if (!sqe) return NULL;
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = c->fd;
+    sqe->user_data = URING_UD(URING_OP_CLOSE, c->io_gen, c->fd);
+    return sqe;
+}
+
+// 根据 user_data 找到仍然存活的连接，代数不匹配说明是已关闭连接遗留的 CQE
+static struct conn *uring_lookup(struct reactor *r, uint64_t ud) {
+    int fd = URING_UD_FD(ud);
+    if (fd < 0 || fd >= CONN_MAX) return NULL;
+    struct conn *c = r->conn_list[fd];
+    if (c == NULL || (c->io_gen & 0xFFFFFF) != URING_UD_GEN(ud)) return NULL;
+    return c;
+}
+
+// ----- 完成事件处理 -----
+
+static void uring_on_accept(struct reactor *r, struct uring_ctx *u, struct io_uring_cqe *cqe) {
+    int lfd = URING_UD_FD(cqe->user_data);
+    // -EINVAL: 内核不支持 multishot accept，重新提交也只会继续失败
+    if (cqe->res == -EINVAL) {
+        log_error("multishot accept unsupported on fd=%d", lfd);
+        return;
+    }
+    // multishot accept 被内核终止（例如出错）时需要重新提交
+    if (!(cqe->flags & IORING_CQE_F_MORE)) {
+        uring_prep_accept(u, lfd);
+    }
+    if (cqe->res < 0) {
+        log_error("accept failed: %s", strerror(-cqe->res));
+        return;
+    }
+
+    int client_fd = cqe->res;
+    struct conn *c = conn_create(r, client_fd);
+    if (c == NULL) {
+        log_error("conn_create failed: client_fd=%d out of range", client_fd);
+        close(client_fd);
+        return;
+    }
+    c->io_gen = ++u->gen;
+
+    STAT_INC(r->stats.total_connections);
+    STAT_INC(r->stats.active_connections);
+    if (r->stats.total_connections % LOG_CONN_EVERY == 0) {
+        print_stats();
+    }
+    uring_prep_recv(u, c);
+    conn_update_timer(r, c);
+}
+
+static void uring_on_recv(struct reactor *r, struct uring_ctx *u, struct io_uring_cqe *cqe) {
+    int has_buf = cqe->flags & IORING_CQE_F_BUFFER;
+    unsigned short bid = (unsigned short)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+    struct conn *c = uring_lookup(r, cqe->user_data);
+    if (c == NULL) {
+        if (has_buf) uring_buf_recycle(u, bid);
+        return;
+    }
+
+    // 缓冲池暂时耗尽，重新排队等待
+    if (cqe->res == -ENOBUFS) {
+        uring_prep_recv(u, c);
+        return;
+    }
+    if (cqe->res <= 0) {
+        if (has_buf) uring_buf_recycle(u, bid);
+        if (cqe->res == 0) {
+            log_ratelimited(LOG_LEVEL_INFO, LOG_DISCONNECT_INTERVAL_MS, "Client disconnected (fd=%d)", c->fd);
+        } else if (cqe->res != -ECANCELED) {
+            log_error("Read failed (fd=%d): %s", c->fd, strerror(-cqe->res));
+        }
+        // -ECANCELED: 链上前一个 send 失败
+        close_conn(c->fd);
+        return;
+    }
+
+    // 追加到 rbuf 后立即归还缓冲区，保持 msg_handler 的接口不变
+    int len = cqe->res;
+    int ret = buffer_append(&c->rbuf, u->bufs + (size_t)bid * URING_BUF_SIZE, len);
+    uring_buf_recycle(u, bid);
+    if (ret < 0) {
+        log_error("Read buffer overflow (fd=%d)", c->fd);
+        close_conn(c->fd);
+        return;
+    }
+    STAT_ADD(r->stats.total_bytes_recv, len);
+
+    // 缓冲区被读满说明内核里可能还有数据，非阻塞地读完，让大请求一次交给 handler
+    while (len == URING_BUF_SIZE) {
+        if (buffer_reserve(&c->rbuf, URING_BUF_SIZE) < 0) break;
+        len = recv(c->fd, buffer_write_ptr(&c->rbuf), URING_BUF_SIZE, MSG_DONTWAIT);
+        if (len <= 0) break;  // EAGAIN 或出错都留给下一次 recv 处理
+        buffer_commit(&c->rbuf, len);
+        STAT_ADD(r->stats.total_bytes_recv, len);
+    }
+
+    if (process_request(r, c) < 0) {
+        return;
+    }
+    // 链接的 send 只能发送一块连续内存，引用片段先拷贝进 wbuf
+    if (outq_flatten(&c->outq, &c->wbuf) < 0) {
+        log_error("Failed to build response (fd=%d)", c->fd);
+        close_conn(c->fd);
+        return;
+    }
+
+    if (buffer_len(&c->wbuf) > 0) {
+        uring_prep_send(u, c);
+        if (c->should_close) {
+            uring_prep_close(u, c);
+        } else {
+            uring_prep_recv(u, c);
+        }
+    } else {
+        buffer_shrink(&c->rbuf);
+        uring_prep_recv(u, c);
+    }
+    conn_update_timer(r, c);
+}
+
+static void uring_on_send(struct reactor *r, struct io_uring_cqe *cqe) {
+    struct conn *c = uring_lookup(r, cqe->user_data);
+    if (c == NULL) return;
+    if (cqe->res < 0) {
+        // 关闭由链上被取消的 recv/close 完成事件统一处理
+        log_error("Write failed (fd=%d): %s", c->fd, strerror(-cqe->res));
+        return;
+    }
+    STAT_ADD(r->stats.total_bytes_sent, cqe->res);
+    buffer_consume(&c->wbuf, cqe->res);
+    buffer_shrink(&c->rbuf);
+    buffer_shrink(&c->wbuf);
+    conn_update_timer(r, c);
+}
+
+static void uring_on_close(struct reactor *r, struct io_uring_cqe *cqe) {
+    struct conn *c = uring_lookup(r, cqe->user_data);
+    if (c == NULL) return;
+    if (cqe->res < 0) {
+        // 前面的 send 失败导致 close 被取消，这里同步关闭
+        close_conn(c->fd);
+        return;
+    }
+    conn_release(r, c->fd);
+}
+
+// ----- 初始化与主循环 -----
+
+// 释放 ring、映射和 provided buffer；关闭 ring_fd 时内核一并注销 buffer ring
+static void uring_ctx_free(struct uring_ctx *u) {
+    if (u->bufs) free(u->bufs);
+    if (u->br && u->br != MAP_FAILED) munmap(u->br, u->br_size);
+    if (u->sqes && u->sqes != MAP_FAILED) munmap(u->sqes, u->sqes_size);
+    if (u->cq_ptr && u->cq_ptr != MAP_FAILED && u->cq_ptr != u->sq_ptr) munmap(u->cq_ptr, u->cq_size);
+    if (u->sq_ptr && u->sq_ptr != MAP_FAILED) munmap(u->sq_ptr, u->sq_size);
+    if (u->ring_fd >= 0) close(u->ring_fd);
+    free(u);
+}
+
+int uring_reactor_init(struct reactor *r) {
+    struct uring_ctx *u = (struct uring_ctx *)calloc(1, sizeof(struct uring_ctx));
+    if (u == NULL) return -1;
+    u->ring_fd = -1;
+
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_CLAMP | IORING_SETUP_COOP_TASKRUN;
+    u->ring_fd = sys_io_uring_setup(URING_ENTRIES, &p);
+    if (u->ring_fd < 0 && errno == EINVAL) {
+        // 旧内核不支持 COOP_TASKRUN
+        memset(&p, 0, sizeof(p));
+        p.flags = IORING_SETUP_CLAMP;
+        u->ring_fd = sys_io_uring_setup(URING_ENTRIES, &p);
+    }
+    if (u->ring_fd < 0) {
+        log_warn("io_uring_setup failed: %s", strerror(errno));
+        free(u);
+        return -1;
+    }
+    // 定时器依赖带超时的 io_uring_enter（5.11+），provided buffer ring 要求的内核更新，一般都满足
+    if (!(p.features & IORING_FEAT_EXT_ARG)) {
+        log_warn("io_uring_enter timeout unsupported");
+        goto fail;
+    }
+
+    u->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    u->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (u->cq_size > u->sq_size) u->sq_size = u->cq_size;
+        u->cq_size = u->sq_size;
+    }
+    u->sq_ptr = mmap(NULL, u->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     u->ring_fd, IORING_OFF_SQ_RING);
+    if (u->sq_ptr == MAP_FAILED) goto fail;
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        u->cq_ptr = u->sq_ptr;
+    } else {
+        u->cq_ptr = mmap(NULL, u->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         u->ring_fd, IORING_OFF_CQ_RING);
+        if (u->cq_ptr == MAP_FAILED) goto fail;
+    }
+    u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   u->ring_fd, IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED) goto fail;
+
+    char *sq = (char *)u->sq_ptr;
+    u->sq_head = (unsigned *)(sq + p.sq_off.head);
+    u->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    u->sq_mask = *(unsigned *)(sq + p.sq_off.ring_mask);
+    u->sq_entries = p.sq_entries;
+    // SQ 索引数组固定为恒等映射，之后只需要移动 tail
+    unsigned *sq_array = (unsigned *)(sq + p.sq_off.array);
+    for (unsigned i = 0; i < p.sq_entries; i++) sq_array[i] = i;
+    u->sq_local_tail = *u->sq_tail;
+    u->sq_submitted = u->sq_local_tail;
+
+    char *cq = (char *)u->cq_ptr;
+    u->cq_head = (unsigned *)(cq + p.cq_off.head);
+    u->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    u->cq_mask = *(unsigned *)(cq + p.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    // provided buffer ring
+    u->br_size = URING_BUF_COUNT * sizeof(struct io_uring_buf);
+    u->br = mmap(NULL, u->br_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (u->br == MAP_FAILED) goto fail;
+    u->bufs = (char *)malloc((size_t)URING_BUF_COUNT * URING_BUF_SIZE);
+    if (u->bufs == NULL) goto fail;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)u->br;
+    reg.ring_entries = URING_BUF_COUNT;
+    reg.bgid = URING_BGID;
+    if (sys_io_uring_register(u->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        log_warn("io_uring provided buffer ring unsupported: %s", strerror(errno));
+        goto fail;
+    }
+    for (int i = 0; i < URING_BUF_COUNT; i++) {
+        uring_buf_recycle(u, (unsigned short)i);
+    }
+
+    r->uring = u;
+    return 0;
+
+fail:
+    uring_ctx_free(u);
+    return -1;
+}
+
+void uring_reactor_free(struct reactor *r) {
+    if (r->uring == NULL) return;
+    uring_ctx_free((struct uring_ctx *)r->uring);
+    r->uring = NULL;
+}
+
+void *uring_reactor_run(void *arg) {
+    struct reactor *r = (struct reactor *)arg;
+    struct uring_ctx *u = (struct uring_ctx *)r->uring;
+    reactor_set_current(r);
+
+    for (int i = 0; i < r->listen_count; i++) {
+        uring_prep_accept(u, r->listen_fds[i]);
+    }
+
+    // mainloop: 一次 io_uring_enter 同时提交上一轮产生的全部 SQE 并等待新的完成事件
+    // 有定时器时最多等到下一个到期的 tick
+    qsbr_register();
+    while (1) {
+        // 等待完成事件期间对 QSBR 来说是下线状态，和 epoll 后端一样
+        qsbr_offline();
+        uring_submit(u, 1, timer_wheel_timeout(&r->timers, r->timers.now_ms));
+        qsbr_online();
+        // 每轮只取一次时间，本轮的日志、统计和超时都读这份缓存
+        clock_update();
+        timer_wheel_update(&r->timers, clock_mono_ms());
+
+        unsigned head = *u->cq_head;
+        unsigned tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            struct io_uring_cqe *cqe = &u->cqes[head & u->cq_mask];
+            switch (URING_UD_OP(cqe->user_data)) {
+                case URING_OP_ACCEPT: uring_on_accept(r, u, cqe); break;
+                case URING_OP_RECV:   uring_on_recv(r, u, cqe);   break;
+                case URING_OP_SEND:   uring_on_send(r, cqe);      break;
+                case URING_OP_CLOSE:  uring_on_close(r, cqe);     break;
+                default: break;
+            }
+            head++;
+        }
+        __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+        // 和 epoll 后端一样在本批完成事件之后处理定时器（过期的 CQE 另有代数校验）
+        timer_wheel_advance(&r->timers, clock_mono_ms());
+    }
+    return NULL;
+}
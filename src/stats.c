@@ -0,0 +1,211 @@
+#include "stats.h"
+#include "logger.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 最多登记的线程数，超出的线程不再采集
+#define STATS_THREADS_MAX 512
+
+int lat_enabled = 0;
+
+const char *lat_stage_name(lat_stage_t stage) {
+    switch (stage) {
+        case LAT_RECV:  return "recv";
+        case LAT_PARSE: return "parse";
+        case LAT_EXEC:  return "exec";
+        case LAT_SEND:  return "send";
+        default:        return "unknown";
+    }
+}
+
+// 每个线程一份（延迟直方图和命令计数），第一次记录时分配并登记，线程退出后也不释放（reactor 线程与进程同寿命）
+// 只有所属线程写入：单写者用 relaxed store 更新（和 STAT_ADD 一样不需要带 lock 前缀的原子加法），
+// 汇总线程用 relaxed load 读取，各字段之间允许轻微不一致（只用于观察），但不会读到撕裂的值
+struct lat_thread {
+    lat_hist_t hist[LAT_STAGE_COUNT];
+    uint64_t exec_total;
+    uint64_t cmd_calls[STATS_CMD_MAX];
+};
+
+static struct lat_thread *lat_threads[STATS_THREADS_MAX];
+static int lat_thread_count = 0;
+static pthread_mutex_t lat_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread struct lat_thread *lat_local = NULL;
+
+static struct lat_thread *lat_thread_get(void) {
+    if (lat_local != NULL) return lat_local;
+    pthread_mutex_lock(&lat_lock);
+    if (lat_thread_count < STATS_THREADS_MAX) {
+        lat_local = (struct lat_thread *)calloc(1, sizeof(struct lat_thread));
+        if (lat_local != NULL) {
+            lat_threads[lat_thread_count] = lat_local;
+            // 先写好指针再增加计数，汇总线程看到的条目都是完整的
+            __atomic_store_n(&lat_thread_count, lat_thread_count + 1, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&lat_lock);
+    return lat_local;
+}
+
+// 值所在的格：小于 2^LAT_SUB_BITS 的值一格一个，之后每个 2 的幂区间分 2^LAT_SUB_BITS 格
+static inline int lat_bucket(uint64_t ns) {
+    if (ns < (1ULL << LAT_SUB_BITS)) return (int)ns;
+    if (ns >= (1ULL << LAT_MAX_BITS)) return LAT_BUCKETS - 1;
+    int msb = 63 - __builtin_clzll(ns);
+    int shift = msb - LAT_SUB_BITS;
+    return ((msb - LAT_SUB_BITS + 1) << LAT_SUB_BITS) + (int)((ns >> shift) & ((1 << LAT_SUB_BITS) - 1));
+}
+
+// 格的上界
+static uint64_t lat_bucket_upper(int idx) {
+    if (idx < (1 << LAT_SUB_BITS)) return (uint64_t)idx;
+    int msb = (idx >> LAT_SUB_BITS) + LAT_SUB_BITS - 1;
+    int shift = msb - LAT_SUB_BITS;
+    uint64_t sub = (uint64_t)(idx & ((1 << LAT_SUB_BITS) - 1));
+    return (((1ULL << LAT_SUB_BITS) + sub + 1) << shift) - 1;
+}
+
+void lat_hist_record(lat_hist_t *h, uint64_t ns) {
+    uint64_t *b = &h->buckets[lat_bucket(ns)];
+    __atomic_store_n(b, *b + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->count, h->count + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->sum, h->sum + ns, __ATOMIC_RELAXED);
+    if (ns > h->max) __atomic_store_n(&h->max, ns, __ATOMIC_RELAXED);
+}
+
+uint64_t lat_hist_percentile(const lat_hist_t *h, double p) {
+    if (h->count == 0) return 0;
+    uint64_t rank = (uint64_t)(p / 100.0 * (double)h->count);
+    if (rank >= h->count) rank = h->count - 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < LAT_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen > rank) {
+            if (i == LAT_BUCKETS - 1) return h->max;
+            uint64_t upper = lat_bucket_upper(i);
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
+
+void lat_record_ns(lat_stage_t stage, uint64_t ns) {
+    struct lat_thread *t = lat_thread_get();
+    if (t == NULL) return;
+    lat_hist_record(&t->hist[stage], ns);
+    if (stage == LAT_EXEC) t->exec_total += ns;
+}
+
+void lat_record(lat_stage_t stage, uint64_t start) {
+    if (start == 0) return;
+    uint64_t now = lat_now();
+    lat_record_ns(stage, now > start ? now - start : 0);
+}
+
+uint64_t lat_exec_total(void) {
+    return lat_local ? lat_local->exec_total : 0;
+}
+
+void lat_collect(lat_stage_t stage, lat_hist_t *out) {
+    memset(out, 0, sizeof(*out));
+    int n = __atomic_load_n(&lat_thread_count, __ATOMIC_ACQUIRE);
+    for (int t = 0; t < n; t++) {
+        const lat_hist_t *h = &lat_threads[t]->hist[stage];
+        for (int i = 0; i < LAT_BUCKETS; i++) {
+            out->buckets[i] += __atomic_load_n(&h->buckets[i], __ATOMIC_RELAXED);
+        }
+        out->count += __atomic_load_n(&h->count, __ATOMIC_RELAXED);
+        out->sum += __atomic_load_n(&h->sum, __ATOMIC_RELAXED);
+        uint64_t max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+        if (max > out->max) out->max = max;
+    }
+}
+
+void lat_report(void) {
+    if (!lat_enabled) return;
+    lat_hist_t h;
+    for (int s = 0; s < LAT_STAGE_COUNT; s++) {
+        lat_collect((lat_stage_t)s, &h);
+        if (h.count == 0) continue;
+        log_info("Latency %-5s: n=%llu avg=%.1fus p50=%.1fus p99=%.1fus p999=%.1fus max=%.1fus",
+                 lat_stage_name((lat_stage_t)s), (unsigned long long)h.count,
+                 h.sum / 1000.0 / h.count,
+                 lat_hist_percentile(&h, 50) / 1000.0,
+                 lat_hist_percentile(&h, 99) / 1000.0,
+                 lat_hist_percentile(&h, 99.9) / 1000.0,
+                 h.max / 1000.0);
+    }
+}
+
+void lat_info(buffer_t *out) {
+    lat_hist_t h;
+    buffer_printf(out, "latency_tracking:%d\r\n", lat_enabled);
+    for (int s = 0; s < LAT_STAGE_COUNT; s++) {
+        lat_collect((lat_stage_t)s, &h);
+        buffer_printf(out, "latency_%s:count=%llu,avg_us=%.2f,p50_us=%.2f,p99_us=%.2f,p999_us=%.2f,max_us=%.2f\r\n",
+                      lat_stage_name((lat_stage_t)s), (unsigned long long)h.count,
+                      h.count ? h.sum / 1000.0 / h.count : 0.0,
+                      lat_hist_percentile(&h, 50) / 1000.0,
+                      lat_hist_percentile(&h, 99) / 1000.0,
+                      lat_hist_percentile(&h, 99.9) / 1000.0,
+                      h.max / 1000.0);
+    }
+}
+
+// 直方图的 le 边界取 2^LAT_METRICS_MIN_BITS .. 2^LAT_METRICS_MAX_BITS 纳秒（约 1us 到 1s）的 2 的幂，
+// 正好落在格的边界上，累计数可以直接按格求和，不需要插值
+#define LAT_METRICS_MIN_BITS 10
+#define LAT_METRICS_MAX_BITS 30
+
+void lat_metrics(buffer_t *out) {
+    if (!lat_enabled) return;
+    lat_hist_t h;
+    metrics_family(out, "netlib_stage_latency_seconds", "histogram",
+                   "Time spent in each request processing stage");
+    for (int s = 0; s < LAT_STAGE_COUNT; s++) {
+        const char *stage = lat_stage_name((lat_stage_t)s);
+        lat_collect((lat_stage_t)s, &h);
+        uint64_t cum = 0;
+        int i = 0;
+        for (int bits = LAT_METRICS_MIN_BITS; bits <= LAT_METRICS_MAX_BITS; bits++) {
+            int end = lat_bucket(1ULL << bits);
+            for (; i < end; i++) {
+                cum += h.buckets[i];
+            }
+            buffer_printf(out, "netlib_stage_latency_seconds_bucket{stage=\"%s\",le=\"%.10g\"} %llu\n",
+                          stage, (double)(1ULL << bits) / 1e9, (unsigned long long)cum);
+        }
+        buffer_printf(out, "netlib_stage_latency_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %llu\n",
+                      stage, (unsigned long long)h.count);
+        buffer_printf(out, "netlib_stage_latency_seconds_sum{stage=\"%s\"} %.9f\n", stage, h.sum / 1e9);
+        buffer_printf(out, "netlib_stage_latency_seconds_count{stage=\"%s\"} %llu\n",
+                      stage, (unsigned long long)h.count);
+    }
+}
+
+void stats_cmd_inc(int cmd) {
+    if (cmd < 0 || cmd >= STATS_CMD_MAX) return;
+    struct lat_thread *t = lat_thread_get();
+    if (t == NULL) return;
+    __atomic_store_n(&t->cmd_calls[cmd], t->cmd_calls[cmd] + 1, __ATOMIC_RELAXED);
+}
+
+void stats_cmd_collect(uint64_t *out) {
+    memset(out, 0, STATS_CMD_MAX * sizeof(uint64_t));
+    int n = __atomic_load_n(&lat_thread_count, __ATOMIC_ACQUIRE);
+    for (int t = 0; t < n; t++) {
+        for (int i = 0; i < STATS_CMD_MAX; i++) {
+            out[i] += __atomic_load_n(&lat_threads[t]->cmd_calls[i], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+void metrics_family(buffer_t *out, const char *name, const char *type, const char *help) {
+    buffer_printf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void metrics_value(buffer_t *out, const char *name, const char *type, const char *help, long long value) {
+    metrics_family(out, name, type, help);
+    buffer_printf(out, "%s %lld\n", name, value);
+}
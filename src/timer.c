@@ -0,0 +1,160 @@
+#include "timer.h"
+#include <string.h>
+
+// 各层槽位索引的起始位
+#define TIMER_LN_SHIFT(lvl) (TIMER_L0_BITS + (lvl) * TIMER_LN_BITS)
+// 能表示的最远距离（tick）
+#define TIMER_MAX_TICKS ((1ULL << TIMER_LN_SHIFT(TIMER_LEVELS)) - 1)
+
+static inline void list_init(timer_node_t *head) {
+    head->prev = head;
+    head->next = head;
+}
+
+static inline int list_empty(const timer_node_t *head) {
+    return head->next == head;
+}
+
+static inline void list_append(timer_node_t *head, timer_node_t *t) {
+    t->prev = head->prev;
+    t->next = head;
+    head->prev->next = t;
+    head->prev = t;
+}
+
+// 把 from 链表整体挪到 to（to 原来必须为空）
+static inline void list_splice(timer_node_t *from, timer_node_t *to) {
+    if (list_empty(from)) {
+        list_init(to);
+        return;
+    }
+    to->next = from->next;
+    to->prev = from->prev;
+    to->next->prev = to;
+    to->prev->next = to;
+    list_init(from);
+}
+
+void timer_wheel_init(timer_wheel_t *tw, long long now_ms) {
+    memset(tw, 0, sizeof(*tw));
+    for (int i = 0; i < TIMER_L0_SIZE; i++) {
+        list_init(&tw->l0[i]);
+    }
+    for (int lvl = 0; lvl < TIMER_LEVELS; lvl++) {
+        for (int i = 0; i < TIMER_LN_SIZE; i++) {
+            list_init(&tw->ln[lvl][i]);
+        }
+    }
+    tw->base_ms = now_ms;
+    tw->now_ms = now_ms;
+}
+
+// 按距离当前 tick 的远近放进对应层的槽
+static void timer_insert(timer_wheel_t *tw, timer_node_t *t) {
+    // 已经过期的放到马上要处理的槽
+    if (t->expire < tw->cur) {
+        t->expire = tw->cur;
+    }
+    unsigned long long idx = t->expire - tw->cur;
+    if (idx > TIMER_MAX_TICKS) {
+        idx = TIMER_MAX_TICKS;
+        t->expire = tw->cur + idx;
+    }
+
+    timer_node_t *slot;
+    if (idx < TIMER_L0_SIZE) {
+        slot = &tw->l0[t->expire & (TIMER_L0_SIZE - 1)];
+    } else {
+        int lvl = 0;
+        while (idx >= (1ULL << TIMER_LN_SHIFT(lvl + 1))) {
+            lvl++;
+        }
+        slot = &tw->ln[lvl][(t->expire >> TIMER_LN_SHIFT(lvl)) & (TIMER_LN_SIZE - 1)];
+    }
+    list_append(slot, t);
+}
+
+void timer_add(timer_wheel_t *tw, timer_node_t *t, int delay_ms, timer_cb cb, void *arg) {
+    if (timer_pending(t)) {
+        timer_del(tw, t);
+    }
+    t->cb = cb;
+    t->arg = arg;
+    // 到期时间向上取整到 tick，保证不会提前触发
+    long long due = tw->now_ms - tw->base_ms + (delay_ms > 0 ? delay_ms : 0);
+    t->expire = ((unsigned long long)due + TIMER_TICK_MS - 1) / TIMER_TICK_MS;
+    timer_insert(tw, t);
+    tw->count++;
+}
+
+void timer_del(timer_wheel_t *tw, timer_node_t *t) {
+    if (!timer_pending(t)) return;
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+    t->prev = NULL;
+    t->next = NULL;
+    tw->count--;
+}
+
+// 把高层的一个槽重新分配到低层，返回槽号（为 0 说明这一层也转完一圈，需要继续下放上一层）
+static int timer_cascade(timer_wheel_t *tw, int lvl, int index) {
+    timer_node_t list;
+    list_splice(&tw->ln[lvl][index], &list);
+    while (!list_empty(&list)) {
+        timer_node_t *t = list.next;
+        t->prev->next = t->next;
+        t->next->prev = t->prev;
+        timer_insert(tw, t);
+    }
+    return index;
+}
+
+int timer_wheel_advance(timer_wheel_t *tw, long long now_ms) {
+    tw->now_ms = now_ms;
+    if (now_ms < tw->base_ms) return 0;
+    unsigned long long target = (unsigned long long)(now_ms - tw->base_ms) / TIMER_TICK_MS;
+    int fired = 0;
+
+    while (tw->cur <= target) {
+        // 没有定时器时所有槽都是空的，直接跳到目标 tick
+        if (tw->count == 0) {
+            tw->cur = target + 1;
+            break;
+        }
+
+        int idx = (int)(tw->cur & (TIMER_L0_SIZE - 1));
+        if (idx == 0) {
+            for (int lvl = 0; lvl < TIMER_LEVELS; lvl++) {
+                int i = (int)((tw->cur >> TIMER_LN_SHIFT(lvl)) & (TIMER_LN_SIZE - 1));
+                if (timer_cascade(tw, lvl, i) != 0) break;
+            }
+        }
+
+        // 先把到期链表摘下来再逐个执行，回调里新加的定时器最早在下一个 tick 触发
+        timer_node_t expired;
+        list_splice(&tw->l0[idx], &expired);
+        tw->cur++;
+        while (!list_empty(&expired)) {
+            timer_node_t *t = expired.next;
+            timer_del(tw, t);
+            t->cb(t->arg);
+            fired++;
+        }
+    }
+    return fired;
+}
+
+int timer_wheel_timeout(const timer_wheel_t *tw, long long now_ms) {
+    if (tw->count == 0) return -1;
+
+    // 只需要看第 0 层到下一次下放之间的槽，下放之后高层的定时器才可能落到第 0 层
+    unsigned long long next = (tw->cur + TIMER_L0_SIZE - 1) & ~(unsigned long long)(TIMER_L0_SIZE - 1);
+    for (unsigned long long k = tw->cur; k < next; k++) {
+        if (!list_empty(&tw->l0[k & (TIMER_L0_SIZE - 1)])) {
+            next = k;
+            break;
+        }
+    }
+    long long wait = tw->base_ms + (long long)next * TIMER_TICK_MS - now_ms;
+    return wait > 0 ? (int)wait : 0;
+}
@@ -4,6 +4,10 @@
 #include <stdio.h>
 #include <stdint.h>
 
+// 数据帧日志每个线程每 N 帧采样一条，握手日志每隔这么久最多一条
+#define WS_LOG_SAMPLE 100
+#define WS_LOG_INTERVAL_MS 1000
+
 // ============== SHA1 实现 (用于 WebSocket 握手) ==============
 // 简化版 SHA1，仅用于 WebSocket 握手
 
@@ -160,8 +164,8 @@ static int is_ws_upgrade(const char *buf, int len) {
     return has_upgrade && has_connection;
 }
 
-// 生成握手响应
-static int ws_handshake_response(const char *client_key, char *response, int resp_size) {
+// 生成握手响应并追加到 out
+static int ws_handshake_response(const char *client_key, buffer_t *out) {
     // 拼接 key + magic
     char combined[128];
     snprintf(combined, sizeof(combined), "%s%s", client_key, WS_MAGIC);
@@ -175,7 +179,7 @@ static int ws_handshake_response(const char *client_key, char *response, int res
     base64_encode(hash, 20, accept_key);
     
     // 构建响应
-    return snprintf(response, resp_size,
+    return buffer_printf(out,
         "HTTP/1.1 101 Switching Protocols\r\n"
         "Upgrade: websocket\r\n"
         "Connection: Upgrade\r\n"
@@ -186,164 +190,194 @@ static int ws_handshake_response(const char *client_key, char *response, int res
 
 // ============== WebSocket 帧处理 ==============
 
-// 解析 WebSocket 帧，返回 payload 起始位置和长度
-// 返回值: 0=成功, -1=数据不完整, -2=错误
-static int ws_parse_frame(const char *buf, int len, 
-                          int *opcode, char **payload, int *payload_len) {
+// 解析帧头，得到帧头长度和载荷长度
+// 返回值: 0=成功, -1=帧头不完整, -2=错误（载荷超过缓冲区上限）
+static int ws_frame_header(const char *buf, int len, int *header_len, int *payload_len) {
     if (len < 2) return -1;
     
-    uint8_t *data = (uint8_t*)buf;
-    // int fin = (data[0] >> 7) & 0x01;
-    *opcode = data[0] & 0x0F;
+    const uint8_t *data = (const uint8_t*)buf;
     int mask = (data[1] >> 7) & 0x01;
     uint64_t plen = data[1] & 0x7F;
-    
-    int header_len = 2;
+    int hlen = 2;
     
     if (plen == 126) {
         if (len < 4) return -1;
         plen = (data[2] << 8) | data[3];
-        header_len = 4;
+        hlen = 4;
     } else if (plen == 127) {
         if (len < 10) return -1;
         plen = 0;
         for (int i = 0; i < 8; i++) {
             plen = (plen << 8) | data[2 + i];
         }
-        header_len = 10;
+        hlen = 10;
     }
     
-    if (mask) header_len += 4;
-    
-    if ((int)(header_len + plen) > len) return -1;
+    if (mask) hlen += 4;
+    if (plen > (uint64_t)(BUFFER_MAX_SIZE - hlen)) return -2;
     
+    *header_len = hlen;
     *payload_len = (int)plen;
-    *payload = (char*)(buf + header_len);
+    return 0;
+}
+
+// 解析一个已经完整收到的 WebSocket 帧，原地解除掩码，返回 opcode 和 payload 位置
+static void ws_parse_frame(char *buf, int header_len, int payload_len,
+                           int *opcode, char **payload) {
+    uint8_t *data = (uint8_t*)buf;
+    // int fin = (data[0] >> 7) & 0x01;
+    *opcode = data[0] & 0x0F;
+    int mask = (data[1] >> 7) & 0x01;
+    *payload = buf + header_len;
     
     // 解除掩码
-    if (mask && plen > 0) {
+    if (mask && payload_len > 0) {
         uint8_t *mask_key = data + header_len - 4;
         uint8_t *p = (uint8_t*)*payload;
-        for (uint64_t i = 0; i < plen; i++) {
+        for (int i = 0; i < payload_len; i++) {
             p[i] ^= mask_key[i % 4];
         }
     }
-    
-    return 0;
 }
 
-// 构建 WebSocket 帧（服务端发送，无掩码）
-static int ws_build_frame(int opcode, const char *payload, int payload_len, 
-                          char *out, int out_size) {
+// 构建 WebSocket 帧（服务端发送，无掩码）并追加到 out，返回帧长度
+static int ws_build_frame(int opcode, const char *payload, int payload_len, buffer_t *out) {
     if (payload_len < 0) return -1;
     
     int header_len;
-    uint8_t *data = (uint8_t*)out;
+    uint8_t header[10];
     
-    data[0] = 0x80 | (opcode & 0x0F);  // FIN=1, opcode
+    header[0] = 0x80 | (opcode & 0x0F);  // FIN=1, opcode
     
     if (payload_len < 126) {
-        data[1] = payload_len;
+        header[1] = payload_len;
         header_len = 2;
     } else if (payload_len < 65536) {
-        data[1] = 126;
-        data[2] = (payload_len >> 8) & 0xFF;
-        data[3] = payload_len & 0xFF;
+        header[1] = 126;
+        header[2] = (payload_len >> 8) & 0xFF;
+        header[3] = payload_len & 0xFF;
         header_len = 4;
     } else {
-        data[1] = 127;
+        header[1] = 127;
         for (int i = 0; i < 8; i++) {
-            data[2 + i] = (payload_len >> ((7 - i) * 8)) & 0xFF;
+            header[2 + i] = ((uint64_t)payload_len >> ((7 - i) * 8)) & 0xFF;
         }
         header_len = 10;
     }
     
-    if (header_len + payload_len > out_size) return -1;
-    
-    memcpy(out + header_len, payload, payload_len);
+    if (buffer_reserve(out, header_len + payload_len) < 0) return -1;
+    buffer_append(out, header, header_len);
+    buffer_append(out, payload, payload_len);
     return header_len + payload_len;
 }
 
 // ============== WebSocket Handler ==============
 
-int ws_handle(struct conn *c) {
-    if (c == NULL) return -1;
-    
-    // 还没有被设为WS协议，说明是握手请求
-    if (c->protocol != PROTO_WS) {
-        log_info("[WS] fd=%d: Received upgrade request", c->fd);
-        
-        if (!is_ws_upgrade(c->rbuff, c->rbuff_len)) {
-            log_info("[WS] fd=%d: Not a valid WebSocket upgrade request", c->fd);
-            return -1;
-        }
-        
-        // 提取 Sec-WebSocket-Key
-        char ws_key[64] = {0};
-        if (get_ws_key(c->rbuff, c->rbuff_len, ws_key, sizeof(ws_key)) == 0) {
-            log_info("[WS] fd=%d: Missing Sec-WebSocket-Key", c->fd);
-            return -1;
-        }
-        
-        log_info("[WS] fd=%d: Handshake success, key=%s", c->fd, ws_key);
-        
-        // 生成握手响应
-        c->wbuff_len = ws_handshake_response(ws_key, c->wbuff, BUF_LEN);
-        c->wbuff_sent = 0;
-        c->protocol = PROTO_WS;
-        c->should_close = 0;  // WebSocket 是长连接
-        
-        return c->wbuff_len;
-    }
-    
-    // 已经是 WebSocket 连接，解析帧
+// 处理一个完整的帧，响应追加到 wbuf，返回追加的长度
+static int ws_handle_frame(struct conn *c, char *frame, int header_len, int payload_len) {
     int opcode;
     char *payload;
-    int payload_len;
-    
-    int ret = ws_parse_frame(c->rbuff, c->rbuff_len, &opcode, &payload, &payload_len);
-    if (ret < 0) {
-        log_info("[WS] fd=%d: Frame parse failed (ret=%d)", c->fd, ret);
-        return ret;
-    }
-    
-    c->wbuff_len = 0;
-    c->wbuff_sent = 0;
+    ws_parse_frame(frame, header_len, payload_len, &opcode, &payload);
     
+    int out_len = 0;
     switch (opcode) {
         case 0x1:  // 文本帧
-            log_info("[WS] fd=%d: Text frame, len=%d, data=\"%.*s\"", 
-                     c->fd, payload_len, payload_len > 64 ? 64 : payload_len, payload);
-            c->wbuff_len = ws_build_frame(opcode, payload, payload_len, 
-                                          c->wbuff, BUF_LEN);
+            log_sampled(LOG_LEVEL_INFO, WS_LOG_SAMPLE, "[WS] fd=%d: Text frame, len=%d, data=\"%.*s\"",
+                        c->fd, payload_len, payload_len > 64 ? 64 : payload_len, payload);
+            out_len = ws_build_frame(opcode, payload, payload_len, &c->wbuf);
             break;
             
         case 0x2:  // 二进制帧
-            log_info("[WS] fd=%d: Binary frame, len=%d", c->fd, payload_len);
-            c->wbuff_len = ws_build_frame(opcode, payload, payload_len, 
-                                          c->wbuff, BUF_LEN);
+            log_sampled(LOG_LEVEL_INFO, WS_LOG_SAMPLE, "[WS] fd=%d: Binary frame, len=%d", c->fd, payload_len);
+            out_len = ws_build_frame(opcode, payload, payload_len, &c->wbuf);
             break;
             
         case 0x8:  // 关闭帧
             log_info("[WS] fd=%d: Close frame received", c->fd);
-            c->wbuff_len = ws_build_frame(0x8, "", 0, c->wbuff, BUF_LEN);
+            out_len = ws_build_frame(0x8, "", 0, &c->wbuf);
             c->should_close = 1;
             break;
             
         case 0x9:  // Ping
-            log_info("[WS] fd=%d: Ping received, sending Pong", c->fd);
-            c->wbuff_len = ws_build_frame(0xA, payload, payload_len, 
-                                          c->wbuff, BUF_LEN);
+            log_sampled(LOG_LEVEL_INFO, WS_LOG_SAMPLE, "[WS] fd=%d: Ping received, sending Pong", c->fd);
+            out_len = ws_build_frame(0xA, payload, payload_len, &c->wbuf);
             break;
             
         case 0xA:  // Pong
-            log_info("[WS] fd=%d: Pong received", c->fd);
+            log_sampled(LOG_LEVEL_INFO, WS_LOG_SAMPLE, "[WS] fd=%d: Pong received", c->fd);
             break;
             
         default:
             log_info("[WS] fd=%d: Unknown opcode=0x%x", c->fd, opcode);
             return -1;
     }
+    return out_len;
+}
+
+int ws_handle(struct conn *c) {
+    if (c == NULL) return -1;
+    
+    int total = 0;
+    
+    // 还没有被设为WS协议，说明是握手请求（分发器保证请求头已经收全）
+    if (c->protocol != PROTO_WS) {
+        log_ratelimited(LOG_LEVEL_INFO, WS_LOG_INTERVAL_MS, "[WS] fd=%d: Received upgrade request", c->fd);
+        
+        const char *req = buffer_peek(&c->rbuf);
+        const char *header_end = strstr(req, "\r\n\r\n");
+        int header_len = header_end ? (int)(header_end - req) + 4 : buffer_len(&c->rbuf);
+        
+        if (!is_ws_upgrade(req, header_len)) {
+            log_info("[WS] fd=%d: Not a valid WebSocket upgrade request", c->fd);
+            return -1;
+        }
+        
+        // 提取 Sec-WebSocket-Key
+        char ws_key[64] = {0};
+        if (get_ws_key(req, header_len, ws_key, sizeof(ws_key)) == 0) {
+            log_info("[WS] fd=%d: Missing Sec-WebSocket-Key", c->fd);
+            return -1;
+        }
+        
+        log_ratelimited(LOG_LEVEL_INFO, WS_LOG_INTERVAL_MS, "[WS] fd=%d: Handshake success, key=%s", c->fd, ws_key);
+        
+        // 生成握手响应
+        total = ws_handshake_response(ws_key, &c->wbuf);
+        if (total < 0) return -1;
+        buffer_consume(&c->rbuf, header_len);
+        c->parse_pos = 0;
+        c->ws_frame_len = 0;
+        c->protocol = PROTO_WS;
+        c->should_close = 0;  // WebSocket 是长连接
+        // 客户端可能紧跟着握手请求发送了数据帧，继续往下处理
+    }
+    
+    // 已经是 WebSocket 连接，依次处理 rbuf 中所有完整的帧
+    // 帧头解析一次后把帧长记在 ws_frame_len，帧没收全时后续读取只比较长度，不重复解析
+    while (buffer_len(&c->rbuf) > 0 && !c->should_close) {
+        char *frame = buffer_peek(&c->rbuf);
+        int len = buffer_len(&c->rbuf);
+        int header_len, payload_len;
+        
+        // 上次已经解析过帧头，载荷还没收全
+        if (c->ws_frame_len > 0 && len < c->ws_frame_len) break;
+        
+        int ret = ws_frame_header(frame, len, &header_len, &payload_len);
+        if (ret == -1) break;  // 帧头不完整，等待更多数据
+        if (ret < 0) {
+            log_info("[WS] fd=%d: Frame parse failed (ret=%d)", c->fd, ret);
+            return ret;
+        }
+        c->ws_frame_len = header_len + payload_len;
+        if (len < c->ws_frame_len) break;  // 载荷不完整，等待更多数据
+        
+        // payload 指向 rbuf 内部，帧处理完之后才能从 rbuf 中丢弃
+        int out_len = ws_handle_frame(c, frame, header_len, payload_len);
+        if (out_len < 0) return out_len;
+        total += out_len;
+        buffer_consume(&c->rbuf, c->ws_frame_len);
+        c->ws_frame_len = 0;
+    }
     
-    return c->wbuff_len;
+    return total;
 }
@@ -30,6 +30,7 @@ THREADS=4
 RW_RATIO=50
 SKIP_BUILD=false
 SKIP_SERVER=false
+SERVER_ARGS=""
 
 # PID文件
 SERVER_PID=""
@@ -67,6 +68,7 @@ QPS 性能测试脚本
     -r, --rw-ratio N       读操作百分比 (默认: 50)
     --skip-build           跳过编译
     --skip-server          跳过启动服务器（用于远程测试）
+    -s, --server-args ARGS 额外的服务器参数，如 "--uring" 或 "--et"
     -h, --help             显示此帮助信息
 
 示例:
@@ -128,6 +130,10 @@ parse_args() {
                 SKIP_SERVER=true
                 shift
                 ;;
+            -s|--server-args)
+                SERVER_ARGS=$2
+                shift 2
+                ;;
             -h|--help)
                 show_help
                 exit 0
@@ -208,7 +214,7 @@ start_server() {
     done
     
     # 启动服务器
-    ./build/server $START_PORT $PORT_COUNT > /tmp/netlib_server.log 2>&1 &
+    ./build/server $START_PORT $PORT_COUNT $SERVER_ARGS > /tmp/netlib_server.log 2>&1 &
     SERVER_PID=$!
     
     # 等待服务器启动
@@ -21,6 +21,52 @@ def send_cmd(sock, cmd, timeout=2.0):
             break
     return b"".join(chunks).decode(errors="ignore")
 
+def check_write_timeout(addr, ns, timeout_ms):
+    # 服务器需要以 --write-timeout <timeout_ms> 启动：一个只发请求不读响应的客户端应当在超时后被关闭，
+    # 期间 reactor 仍然能服务其他连接（发送不能阻塞）
+    key = f"{ns}_big"
+    with socket.create_connection(addr, timeout=3.0) as sock:
+        resp = send_cmd(sock, f"HSET {key} {'v' * 60000}").strip()
+        if resp != "OK":
+            print(f"FAIL write-timeout: HSET big value -> {resp}")
+            return False
+
+    slow = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    slow.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 4096)
+    slow.connect(addr)
+    # 流水线请求约 12MB 的响应，远超两端的套接字缓冲区；先读一部分让服务器收到 EPOLLOUT 继续发送，然后不再读取
+    slow.sendall(f"HGET {key}\r\n".encode() * 200)
+    slow.settimeout(2.0)
+    got = 0
+    while got < 2 * 1024 * 1024:
+        got += len(slow.recv(65536))
+    time.sleep(0.2)
+
+    with socket.create_connection(addr, timeout=2.0) as other:
+        try:
+            resp = send_cmd(other, f"HEXIST {key}").strip()
+        except OSError as e:
+            resp = str(e)
+        if resp != "OK":
+            print(f"FAIL write-timeout: reactor stalled while a client stopped reading ({resp!r})")
+            return False
+
+    # 超时之前不读，读取会让服务器继续发送、重新计时；之后读完残留的数据应当看到连接被关闭
+    time.sleep(timeout_ms / 1000.0 + 1.0)
+    slow.settimeout(2.0)
+    try:
+        while slow.recv(65536):
+            pass
+    except ConnectionResetError:
+        pass
+    except socket.timeout:
+        print(f"FAIL write-timeout: connection still open after {timeout_ms}ms")
+        return False
+    finally:
+        slow.close()
+    print(f"PASS write-timeout {timeout_ms}ms")
+    return True
+
 def main():
     parser = argparse.ArgumentParser(description="KVS+Reactor integration test client")
     parser.add_argument("host", help="server host")
@@ -28,6 +74,8 @@ def main():
     parser.add_argument("command", nargs='*', help="command to send, e.g. SET k v")
     parser.add_argument("--batch", action="store_true", help="run assertion-based batch tests")
     parser.add_argument("--prefix", default=None, help="key namespace prefix to avoid collisions")
+    parser.add_argument("--write-timeout", type=int, default=0, metavar="MS",
+                        help="check that a client which stops reading is closed (server started with --write-timeout MS)")
     args = parser.parse_args()
 
     addr = (args.host, args.port)
@@ -35,6 +83,9 @@ def main():
     ns = args.prefix or ("ns" + str(int(time.time())))
     print(f"namespace: {ns}")
 
+    if args.write_timeout > 0:
+        sys.exit(0 if check_write_timeout(addr, ns, args.write_timeout) else 1)
+
     try:
         with socket.create_connection(addr, timeout=3.0) as sock:
             if args.command:
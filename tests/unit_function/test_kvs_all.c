@@ -1,16 +1,31 @@
 #include "../include/kvstore.h"
 #include "../include/kvs_rbtree.h"
 #include "../include/kvs_hash.h"
+#include "../include/kvs_swiss.h"
+#include "../include/qsbr.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 
 // ========== 测试配置 ==========
 #define TEST_BASIC_COUNT    10      // 基础功能测试的键值对数量
 #define TEST_STRESS_INSERT  1000    // 压力测试：插入数量
 #define TEST_STRESS_MODIFY  500     // 压力测试：修改数量
 #define TEST_STRESS_DELETE  500     // 压力测试：删除数量
+#define TEST_THREAD_KEYS    100000  // 多线程查询测试：预先插入的键数
+#define TEST_THREAD_OPS     200000  // 多线程查询测试：每个线程的查询次数
+#define TEST_THREAD_SHARDS  64      // 多线程查询测试：分片模式的分片数
+#define TEST_RCU_KEYS       4096    // 无锁读测试：写线程反复删除/重建的键数
+#define TEST_SCAN_KEYS      3000    // 遍历测试：遍历期间一直存在的键数
+#define TEST_SCAN_EXTRA     400     // 遍历测试：扩容阶段每次调用之后插入的临时键数
+#define TEST_RCU_ROUNDS     30      // 无锁读测试：写线程的轮数，每轮删 7/8、改 1/8、再插回来
 
 // 可以通过命令行参数覆盖
 int g_insert_count = TEST_STRESS_INSERT;
@@ -274,9 +289,9 @@ int test_hash_basic() {
     printf("\n" COLOR_YELLOW "[基础功能测试]" COLOR_RESET "\n");
     
     hashtable_t hash;
-    hash.nodes = NULL;
-    hash.max_slots = 0;
-    hash.count = 0;
+    hash.shards = NULL;
+    hash.shard_count = 0;
+    hash.shard_bits = 0;
     
     if (kvs_hash_create(&hash) != KVS_OK) {
         printf(COLOR_RED "✗ 创建失败\n" COLOR_RESET);
@@ -316,9 +331,9 @@ int test_hash_stress(perf_stats_t* stats) {
     printf("\n" COLOR_YELLOW "[压力测试]" COLOR_RESET "\n");
     
     hashtable_t hash;
-    hash.nodes = NULL;
-    hash.max_slots = 0;
-    hash.count = 0;
+    hash.shards = NULL;
+    hash.shard_count = 0;
+    hash.shard_bits = 0;
     
     if (kvs_hash_create(&hash) != KVS_OK) return -1;
     
@@ -379,6 +394,671 @@ int test_hash_stress(perf_stats_t* stats) {
     return 0;
 }
 
+// 渐进式 rehash：插入大量键让表扩容，期间和之后所有键都能查到；删光后缩回初始大小
+int test_hash_resize() {
+    printf("\n" COLOR_YELLOW "[扩容/缩容测试]" COLOR_RESET "\n");
+
+    hashtable_t hash;
+    if (kvs_hash_create(&hash) != KVS_OK) return -1;
+    int init_slots = kvs_hash_slots(&hash);
+    int n = init_slots * 64;
+
+    for (int i = 0; i < n; i++) {
+        char key[32];
+        snprintf(key, sizeof(key), "resize_%d", i);
+        if (kvs_hash_set(&hash, key, key) != KVS_OK) {
+            printf(COLOR_RED "✗ 插入失败 (%s)\n" COLOR_RESET, key);
+            kvs_hash_destroy(&hash);
+            return -1;
+        }
+    }
+    int grown = kvs_hash_slots(&hash);
+    for (int i = 0; i < n; i++) {
+        char key[32];
+        char *val = NULL;
+        snprintf(key, sizeof(key), "resize_%d", i);
+        if (kvs_hash_get(&hash, key, &val) != KVS_OK || strcmp(val, key) != 0) {
+            printf(COLOR_RED "✗ 扩容后查询失败 (%s)\n" COLOR_RESET, key);
+            kvs_hash_destroy(&hash);
+            return -1;
+        }
+    }
+    printf(COLOR_GREEN "✓" COLOR_RESET " %d 个键，槽位 %d -> %d\n", n, init_slots, grown);
+
+    for (int i = 0; i < n; i++) {
+        char key[32];
+        snprintf(key, sizeof(key), "resize_%d", i);
+        if (kvs_hash_del(&hash, key) != KVS_OK) {
+            printf(COLOR_RED "✗ 删除失败 (%s)\n" COLOR_RESET, key);
+            kvs_hash_destroy(&hash);
+            return -1;
+        }
+    }
+    // 缩容同样是渐进的，再做一些查询把迁移推进完
+    for (int i = 0; i < grown; i++) {
+        kvs_hash_exist(&hash, "resize_none");
+    }
+    int shrunk = kvs_hash_slots(&hash);
+    kvs_hash_destroy(&hash);
+    if (grown <= init_slots || shrunk != init_slots) {
+        printf(COLOR_RED "✗ 槽位数不符合预期 (扩容后 %d, 缩容后 %d)\n" COLOR_RESET, grown, shrunk);
+        return -1;
+    }
+    printf(COLOR_GREEN "✓" COLOR_RESET " 删除全部键后槽位缩回 %d\n", shrunk);
+    return 0;
+}
+
+// 分片模式：键按哈希值高位分散到各分片，每个分片独立扩容/缩容，键数和槽位数是各分片之和
+int test_hash_sharded() {
+    printf("\n" COLOR_YELLOW "[分片测试]" COLOR_RESET "\n");
+
+    hashtable_t hash;
+    int shards = 16;
+    if (kvs_hash_create_sharded(&hash, 3) != KVS_ERR_PARAM ||
+        kvs_hash_create_sharded(&hash, shards) != KVS_OK) {
+        printf(COLOR_RED "✗ 创建失败\n" COLOR_RESET);
+        return -1;
+    }
+    int init_slots = kvs_hash_slots(&hash);
+    int n = init_slots * 64;
+
+    for (int i = 0; i < n; i++) {
+        char key[32];
+        snprintf(key, sizeof(key), "shard_%d", i);
+        if (kvs_hash_set(&hash, key, key) != KVS_OK) {
+            printf(COLOR_RED "✗ 插入失败 (%s)\n" COLOR_RESET, key);
+            kvs_hash_destroy(&hash);
+            return -1;
+        }
+    }
+    int min = n, max = 0, sum = 0;
+    for (int i = 0; i < shards; i++) {
+        int c = kvs_hash_shard_count(&hash, i);
+        sum += c;
+        if (c < min) min = c;
+        if (c > max) max = c;
+    }
+    int grown = kvs_hash_slots(&hash);
+    if (sum != n || kvs_hash_count(&hash) != n || min == 0) {
+        printf(COLOR_RED "✗ 分片键数不符合预期 (合计 %d, 最少 %d)\n" COLOR_RESET, sum, min);
+        kvs_hash_destroy(&hash);
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        char key[32];
+        char *val = NULL;
+        snprintf(key, sizeof(key), "shard_%d", i);
+        if (kvs_hash_get(&hash, key, &val) != KVS_OK || strcmp(val, key) != 0) {
+            printf(COLOR_RED "✗ 查询失败 (%s)\n" COLOR_RESET, key);
+            kvs_hash_destroy(&hash);
+            return -1;
+        }
+    }
+    printf(COLOR_GREEN "✓" COLOR_RESET " %d 个分片 %d 个键，每片 %d ~ %d 个，槽位 %d -> %d\n",
+           shards, n, min, max, init_slots, grown);
+
+    for (int i = 0; i < n; i++) {
+        char key[32];
+        snprintf(key, sizeof(key), "shard_%d", i);
+        kvs_hash_del(&hash, key);
+    }
+    for (int i = 0; i < grown; i++) {
+        char key[32];
+        snprintf(key, sizeof(key), "none_%d", i);
+        kvs_hash_exist(&hash, key);
+    }
+    int shrunk = kvs_hash_slots(&hash);
+    kvs_hash_destroy(&hash);
+    if (shrunk != init_slots) {
+        printf(COLOR_RED "✗ 删除后槽位 %d，预期缩回 %d\n" COLOR_RESET, shrunk, init_slots);
+        return -1;
+    }
+    printf(COLOR_GREEN "✓" COLOR_RESET " 删除全部键后槽位缩回 %d\n", shrunk);
+    return 0;
+}
+
+typedef struct {
+    hashtable_t *hash;
+    int seed;
+    int rcu;        // 是否登记 QSBR，走无锁查询
+    int hits;
+} hash_reader_t;
+
+// 只读线程：随机查询预先插入的键；无锁模式每 64 次查询经过一次静止点，模拟 reactor 的事件循环
+static void *hash_reader(void *arg) {
+    hash_reader_t *r = (hash_reader_t *)arg;
+    unsigned x = (unsigned)r->seed * 2654435761u + 1;
+    if (r->rcu) {
+        qsbr_register();
+        qsbr_online();
+    }
+    for (int i = 0; i < TEST_THREAD_OPS; i++) {
+        char key[32];
+        char *val = NULL;
+        x = x * 1103515245u + 12345u;
+        snprintf(key, sizeof(key), "key_%u", (x >> 8) % TEST_THREAD_KEYS);
+        if (kvs_hash_get(r->hash, key, &val) == KVS_OK) {
+            r->hits++;
+        }
+        if (r->rcu && (i & 63) == 63) {
+            qsbr_quiescent();
+        }
+    }
+    if (r->rcu) {
+        qsbr_offline();
+    }
+    return NULL;
+}
+
+static double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// 多线程只读吞吐：不分片（单把锁）、分片、无锁查询三种模式各跑 1/2/4/8 个线程，按墙上时间计算
+int test_hash_threads() {
+    printf("\n" COLOR_YELLOW "[多线程查询测试]" COLOR_RESET " 每线程 %d 次查询，%ld 个 CPU 核（线程数超过核数后不会再提升）\n",
+           TEST_THREAD_OPS, sysconf(_SC_NPROCESSORS_ONLN));
+    int shard_modes[3] = { 1, TEST_THREAD_SHARDS, 1 };
+    int rcu_modes[3] = { 0, 0, 1 };
+    int thread_counts[4] = { 1, 2, 4, 8 };
+
+    for (int m = 0; m < 3; m++) {
+        hashtable_t hash;
+        if (kvs_hash_create_sharded(&hash, shard_modes[m]) != KVS_OK) return -1;
+        for (int i = 0; i < TEST_THREAD_KEYS; i++) {
+            char key[32];
+            snprintf(key, sizeof(key), "key_%d", i);
+            kvs_hash_set(&hash, key, key);
+        }
+        printf("  %3d 个分片%s:", shard_modes[m], rcu_modes[m] ? "(无锁)" : "      ");
+        for (int t = 0; t < 4; t++) {
+            int n = thread_counts[t];
+            pthread_t tids[8];
+            hash_reader_t readers[8];
+            double start = now_ms();
+            for (int i = 0; i < n; i++) {
+                readers[i].hash = &hash;
+                readers[i].seed = i;
+                readers[i].rcu = rcu_modes[m];
+                readers[i].hits = 0;
+                pthread_create(&tids[i], NULL, hash_reader, &readers[i]);
+            }
+            int hits = 0;
+            for (int i = 0; i < n; i++) {
+                pthread_join(tids[i], NULL);
+                hits += readers[i].hits;
+            }
+            double elapsed = now_ms() - start;
+            if (hits != n * TEST_THREAD_OPS) {
+                printf(COLOR_RED "\n✗ 查询结果不完整 (%d/%d)\n" COLOR_RESET, hits, n * TEST_THREAD_OPS);
+                kvs_hash_destroy(&hash);
+                return -1;
+            }
+            printf("  %d 线程 %6.2f Mops/s", n, n * TEST_THREAD_OPS / elapsed / 1000.0);
+        }
+        printf("\n");
+        kvs_hash_destroy(&hash);
+    }
+    return 0;
+}
+
+typedef struct {
+    hashtable_t *hash;
+    swisstable_t *swiss;    // 非 NULL 时测试 SwissTable 引擎
+    int seed;
+    int *stop;      // 写线程结束后置 1，读线程随之退出
+    long reads;
+    long bad;       // 读到的值和键对不上的次数
+} hash_rcu_arg_t;
+
+// 按测试的引擎分发
+static int rcu_get(hash_rcu_arg_t *a, char *key, char **val) {
+    return a->swiss ? kvs_swiss_get(a->swiss, key, val) : kvs_hash_get(a->hash, key, val);
+}
+
+static int rcu_set(hash_rcu_arg_t *a, char *key, char *val) {
+    return a->swiss ? kvs_swiss_set(a->swiss, key, val) : kvs_hash_set(a->hash, key, val);
+}
+
+static int rcu_mod(hash_rcu_arg_t *a, char *key, char *val) {
+    return a->swiss ? kvs_swiss_mod(a->swiss, key, val) : kvs_hash_mod(a->hash, key, val);
+}
+
+static int rcu_del(hash_rcu_arg_t *a, char *key) {
+    return a->swiss ? kvs_swiss_del(a->swiss, key) : kvs_hash_del(a->hash, key);
+}
+
+// 读线程（登记 QSBR）：查询到的值必须以 "键:" 开头，读到已释放或写了一半的节点都会对不上
+static void *hash_rcu_reader(void *arg) {
+    hash_rcu_arg_t *a = (hash_rcu_arg_t *)arg;
+    unsigned x = (unsigned)a->seed * 2654435761u + 1;
+    qsbr_register();
+    qsbr_online();
+    while (!__atomic_load_n(a->stop, __ATOMIC_ACQUIRE)) {
+        char key[32];
+        char *val = NULL;
+        x = x * 1103515245u + 12345u;
+        int len = snprintf(key, sizeof(key), "key_%u", (x >> 8) % TEST_RCU_KEYS);
+        if (rcu_get(a, key, &val) == KVS_OK) {
+            if (strncmp(val, key, len) != 0 || val[len] != ':') {
+                a->bad++;
+            }
+        }
+        if ((++a->reads & 63) == 0) {
+            qsbr_quiescent();
+        }
+    }
+    qsbr_offline();
+    return NULL;
+}
+
+// 写线程：每轮删掉 7/8 的键（触发缩容）、修改剩下的（换节点）、再插回来（触发扩容）
+static void *hash_rcu_writer(void *arg) {
+    hash_rcu_arg_t *a = (hash_rcu_arg_t *)arg;
+    char key[32], val[64];
+    qsbr_register();
+    qsbr_online();
+    for (int round = 0; round < TEST_RCU_ROUNDS; round++) {
+        for (int i = 0; i < TEST_RCU_KEYS; i++) {
+            snprintf(key, sizeof(key), "key_%d", i);
+            snprintf(val, sizeof(val), "key_%d:%d", i, round);
+            if (i % 8 != 0) {
+                rcu_del(a, key);
+            } else {
+                rcu_mod(a, key, val);
+            }
+            if ((i & 63) == 0) {
+                qsbr_quiescent();
+            }
+        }
+        for (int i = 0; i < TEST_RCU_KEYS; i++) {
+            if (i % 8 == 0) {
+                continue;
+            }
+            snprintf(key, sizeof(key), "key_%d", i);
+            snprintf(val, sizeof(val), "key_%d:%d", i, round);
+            rcu_set(a, key, val);
+        }
+    }
+    // 先下线再通知读线程退出，读线程最后一次下线时就能回收自己挂起的内存
+    qsbr_offline();
+    __atomic_store_n(a->stop, 1, __ATOMIC_RELEASE);
+    // 等读线程都下线，把自己挂起的节点全部回收
+    for (int i = 0; i < 100000 && qsbr_pending() > 0; i++) {
+        qsbr_offline();
+        sched_yield();
+    }
+    return NULL;
+}
+
+// 并发查询和删除/修改/扩缩容：读到的值始终完整，换下的内存在读线程全部下线后都被回收
+// swiss 为 1 时测试 SwissTable 引擎（查询加锁，但返回的值指针同样靠 QSBR 保持有效）
+int test_hash_rcu(int swiss) {
+    printf("\n" COLOR_YELLOW "[%s查询测试]" COLOR_RESET " 1 个写线程 %d 轮，4 个读线程\n",
+           swiss ? "SwissTable 并发" : "无锁", TEST_RCU_ROUNDS);
+    hashtable_t hash;
+    swisstable_t st;
+    hash_rcu_arg_t wa = { &hash, swiss ? &st : NULL, 0, NULL, 0, 0 };
+    if ((swiss ? kvs_swiss_create(&st) : kvs_hash_create(&hash)) != KVS_OK) return -1;
+    for (int i = 0; i < TEST_RCU_KEYS; i++) {
+        char key[32], val[64];
+        snprintf(key, sizeof(key), "key_%d", i);
+        snprintf(val, sizeof(val), "key_%d:init", i);
+        rcu_set(&wa, key, val);
+    }
+
+    int stop = 0;
+    pthread_t writer, readers[4];
+    wa.stop = &stop;
+    hash_rcu_arg_t ra[4];
+    for (int i = 0; i < 4; i++) {
+        ra[i] = wa;
+        ra[i].seed = i + 1;
+        pthread_create(&readers[i], NULL, hash_rcu_reader, &ra[i]);
+    }
+    pthread_create(&writer, NULL, hash_rcu_writer, &wa);
+    pthread_join(writer, NULL);
+    long reads = 0, bad = 0;
+    for (int i = 0; i < 4; i++) {
+        pthread_join(readers[i], NULL);
+        reads += ra[i].reads;
+        bad += ra[i].bad;
+    }
+    long pending = qsbr_pending();
+    int count = swiss ? kvs_swiss_count(&st) : kvs_hash_count(&hash);
+    if (swiss) {
+        kvs_swiss_destroy(&st);
+    } else {
+        kvs_hash_destroy(&hash);
+    }
+
+    if (bad != 0) {
+        printf(COLOR_RED "✗ %ld 次查询读到的值和键不匹配\n" COLOR_RESET, bad);
+        return -1;
+    }
+    if (count != TEST_RCU_KEYS) {
+        printf(COLOR_RED "✗ 键数 %d，预期 %d\n" COLOR_RESET, count, TEST_RCU_KEYS);
+        return -1;
+    }
+    if (pending != 0) {
+        printf(COLOR_RED "✗ 线程全部下线后仍有 %ld 块内存未回收\n" COLOR_RESET, pending);
+        return -1;
+    }
+    printf(COLOR_GREEN "✓" COLOR_RESET " %ld 次查询全部读到完整的值，换下的内存全部回收\n", reads);
+    return 0;
+}
+
+typedef struct {
+    char *seen;     // 每个常驻键被返回的次数（超过 1 的计为重复）
+    int returned;
+    int dups;
+} hash_scan_ctx_t;
+
+static void hash_scan_collect(const char *key, void *arg) {
+    hash_scan_ctx_t *ctx = (hash_scan_ctx_t *)arg;
+    int i;
+    ctx->returned++;
+    if (sscanf(key, "stable_%d", &i) == 1 && i >= 0 && i < TEST_SCAN_KEYS) {
+        if (ctx->seen[i]++ > 0) {
+            ctx->dups++;
+        }
+    }
+}
+
+// 增量遍历：一边遍历一边插入大量临时键（扩容）、再全部删掉（缩容），遍历期间一直存在的键都必须被返回
+int test_hash_scan() {
+    printf("\n" COLOR_YELLOW "[增量遍历测试]" COLOR_RESET " %d 个常驻键，遍历期间先扩容再缩容\n", TEST_SCAN_KEYS);
+    int shard_modes[2] = { 1, 16 };
+    char key[32];
+
+    for (int m = 0; m < 2; m++) {
+        hashtable_t hash;
+        if (kvs_hash_create_sharded(&hash, shard_modes[m]) != KVS_OK) return -1;
+        for (int i = 0; i < TEST_SCAN_KEYS; i++) {
+            snprintf(key, sizeof(key), "stable_%d", i);
+            kvs_hash_set(&hash, key, key);
+        }
+
+        char seen[TEST_SCAN_KEYS] = {0};
+        hash_scan_ctx_t ctx = { seen, 0, 0 };
+        int start_slots = kvs_hash_slots(&hash), max_slots = start_slots;
+        int extra = 0, deleted = 0, calls = 0;
+        uint64_t cursor = 0;
+        do {
+            if (kvs_hash_scan(&hash, cursor, 17, NULL, hash_scan_collect, &ctx, &cursor) != KVS_OK) {
+                printf(COLOR_RED "✗ 遍历失败\n" COLOR_RESET);
+                kvs_hash_destroy(&hash);
+                return -1;
+            }
+            calls++;
+            // 前 60 次调用之后各插入一批临时键，之后每次删掉两批；删完之后用查询推进缩容的迁移
+            if (calls <= 60) {
+                for (int i = 0; i < TEST_SCAN_EXTRA; i++, extra++) {
+                    snprintf(key, sizeof(key), "extra_%d", extra);
+                    kvs_hash_set(&hash, key, key);
+                }
+            } else if (deleted < extra) {
+                for (int i = 0; i < TEST_SCAN_EXTRA * 2 && deleted < extra; i++, deleted++) {
+                    snprintf(key, sizeof(key), "extra_%d", deleted);
+                    kvs_hash_del(&hash, key);
+                }
+            } else {
+                for (int i = 0; i < TEST_SCAN_EXTRA; i++) {
+                    snprintf(key, sizeof(key), "stable_%d", i);
+                    kvs_hash_exist(&hash, key);
+                }
+            }
+            int slots = kvs_hash_slots(&hash);
+            if (slots > max_slots) max_slots = slots;
+        } while (cursor != 0);
+        int end_slots = kvs_hash_slots(&hash);
+        kvs_hash_destroy(&hash);
+
+        int missing = 0;
+        for (int i = 0; i < TEST_SCAN_KEYS; i++) {
+            if (seen[i] == 0) missing++;
+        }
+        if (missing != 0) {
+            printf(COLOR_RED "✗ %d 个分片：%d 个常驻键没有被遍历到\n" COLOR_RESET, shard_modes[m], missing);
+            return -1;
+        }
+        if (max_slots <= start_slots || end_slots >= max_slots) {
+            printf(COLOR_RED "✗ %d 个分片：遍历期间没有发生扩容和缩容 (%d -> %d -> %d)\n" COLOR_RESET,
+                   shard_modes[m], start_slots, max_slots, end_slots);
+            return -1;
+        }
+        printf(COLOR_GREEN "✓" COLOR_RESET " %3d 个分片：%d 次调用，槽位 %d -> %d -> %d，常驻键全部返回（重复 %d 个）\n",
+               shard_modes[m], calls, start_slots, max_slots, end_slots, ctx.dups);
+    }
+    return 0;
+}
+
+// 当前已分配的堆内存字节数，用于估算每个键的内存占用；非 glibc 返回 0
+static size_t heap_in_use() {
+#ifdef __GLIBC__
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+// 节点按键值实际长度分配：统计短键短值时每个键的内存占用，并验证超过 512 字节的长值可以存取和修改
+int test_hash_memory() {
+    printf("\n" COLOR_YELLOW "[内存占用测试]" COLOR_RESET "\n");
+
+    size_t before = heap_in_use();
+    hashtable_t hash;
+    if (kvs_hash_create(&hash) != KVS_OK) return -1;
+    for (int i = 0; i < g_insert_count; i++) {
+        char key[32], val[64];
+        snprintf(key, sizeof(key), "key_%d", i);
+        snprintf(val, sizeof(val), "value_%d", i);
+        kvs_hash_set(&hash, key, val);
+    }
+    size_t used = heap_in_use() - before;
+    if (before != 0 && kvs_hash_count(&hash) > 0) {
+        printf(COLOR_GREEN "✓" COLOR_RESET " %d 个键，每个键约 %zu 字节（含桶数组和 malloc 开销）\n",
+               kvs_hash_count(&hash), used / kvs_hash_count(&hash));
+    }
+
+    // 长值：插入、读取、改成更长的值（节点重新分配）、再改短（原地覆盖）
+    size_t big_len = 64 * 1024;
+    char *big = (char *)malloc(big_len + 1);
+    memset(big, 'v', big_len);
+    big[big_len] = '\0';
+    char *val = NULL;
+    int ok = kvs_hash_set(&hash, "big", big + big_len / 2) == KVS_OK &&
+             kvs_hash_get(&hash, "big", &val) == KVS_OK && strlen(val) == big_len / 2 &&
+             kvs_hash_mod(&hash, "big", big) == KVS_OK &&
+             kvs_hash_get(&hash, "big", &val) == KVS_OK && strlen(val) == big_len &&
+             kvs_hash_mod(&hash, "big", "small") == KVS_OK &&
+             kvs_hash_get(&hash, "big", &val) == KVS_OK && strcmp(val, "small") == 0 &&
+             kvs_hash_del(&hash, "big") == KVS_OK;
+    free(big);
+    kvs_hash_destroy(&hash);
+    if (!ok) {
+        printf(COLOR_RED "✗ 长值存取失败\n" COLOR_RESET);
+        return -1;
+    }
+    printf(COLOR_GREEN "✓" COLOR_RESET " %zu 字节的长值存取、修改正常\n", big_len);
+    return 0;
+}
+
+// ========== SwissTable 测试函数 ==========
+int test_swiss_basic() {
+    printf("\n" COLOR_YELLOW "[基础功能测试]" COLOR_RESET "\n");
+    
+    swisstable_t t;
+    if (kvs_swiss_create(&t) != KVS_OK) {
+        printf(COLOR_RED "✗ 创建失败\n" COLOR_RESET);
+        return -1;
+    }
+    printf(COLOR_GREEN "✓" COLOR_RESET " 创建成功\n");
+    
+    if (kvs_swiss_set(&t, "name", "张三") == KVS_OK &&
+        kvs_swiss_set(&t, "age", "25") == KVS_OK &&
+        kvs_swiss_set(&t, "name", "王五") == KVS_ERR_EXISTS) {
+        printf(COLOR_GREEN "✓" COLOR_RESET " Set 操作正常\n");
+    }
+    
+    char* value = NULL;
+    if (kvs_swiss_get(&t, "name", &value) == KVS_OK && value != NULL) {
+        printf(COLOR_GREEN "✓" COLOR_RESET " Get 操作正常 (name=%s)\n", value);
+    }
+    
+    // 新值比旧值长时会换一块内存
+    if (kvs_swiss_mod(&t, "age", "twenty-five") == KVS_OK &&
+        kvs_swiss_get(&t, "age", &value) == KVS_OK && strcmp(value, "twenty-five") == 0) {
+        printf(COLOR_GREEN "✓" COLOR_RESET " Mod 操作正常\n");
+    }
+    
+    if (kvs_swiss_exist(&t, "name") == KVS_OK && kvs_swiss_exist(&t, "nobody") == KVS_ERR_NOTFOUND) {
+        printf(COLOR_GREEN "✓" COLOR_RESET " Exist 操作正常\n");
+    }
+    
+    if (kvs_swiss_del(&t, "age") == KVS_OK && kvs_swiss_get(&t, "age", &value) == KVS_ERR_NOTFOUND) {
+        printf(COLOR_GREEN "✓" COLOR_RESET " Del 操作正常\n");
+    }
+    
+    kvs_swiss_destroy(&t);
+    printf(COLOR_GREEN "✓" COLOR_RESET " 销毁成功\n");
+    
+    return 0;
+}
+
+int test_swiss_stress(perf_stats_t* stats) {
+    printf("\n" COLOR_YELLOW "[压力测试]" COLOR_RESET "\n");
+    
+    swisstable_t t;
+    if (kvs_swiss_create(&t) != KVS_OK) return -1;
+    
+    // 插入测试
+    clock_t start = clock();
+    stats->insert_success = 0;
+    for (int i = 0; i < g_insert_count; i++) {
+        char key[32], val[64];
+        snprintf(key, sizeof(key), "key_%d", i);
+        snprintf(val, sizeof(val), "value_%d", i);
+        if (kvs_swiss_set(&t, key, val) == KVS_OK) {
+            stats->insert_success++;
+        }
+    }
+    stats->insert_time = (double)(clock() - start) / CLOCKS_PER_SEC * 1000;
+    
+    // 查询测试
+    start = clock();
+    stats->query_success = 0;
+    for (int i = 0; i < stats->insert_success; i++) {
+        char key[32];
+        char* val = NULL;
+        snprintf(key, sizeof(key), "key_%d", i);
+        if (kvs_swiss_get(&t, key, &val) == KVS_OK) {
+            stats->query_success++;
+        }
+    }
+    stats->query_time = (double)(clock() - start) / CLOCKS_PER_SEC * 1000;
+    
+    // 修改测试
+    start = clock();
+    stats->modify_success = 0;
+    int mod_count = (g_modify_count < stats->insert_success) ? g_modify_count : stats->insert_success;
+    for (int i = 0; i < mod_count; i++) {
+        char key[32], val[64];
+        snprintf(key, sizeof(key), "key_%d", i);
+        snprintf(val, sizeof(val), "modified_%d", i);
+        if (kvs_swiss_mod(&t, key, val) == KVS_OK) {
+            stats->modify_success++;
+        }
+    }
+    stats->modify_time = (double)(clock() - start) / CLOCKS_PER_SEC * 1000;
+    
+    // 删除测试
+    start = clock();
+    stats->delete_success = 0;
+    int del_count = (g_delete_count < stats->insert_success) ? g_delete_count : stats->insert_success;
+    for (int i = 0; i < del_count; i++) {
+        char key[32];
+        snprintf(key, sizeof(key), "key_%d", i);
+        if (kvs_swiss_del(&t, key) == KVS_OK) {
+            stats->delete_success++;
+        }
+    }
+    stats->delete_time = (double)(clock() - start) / CLOCKS_PER_SEC * 1000;
+    
+    kvs_swiss_destroy(&t);
+    return 0;
+}
+
+// 扩容、墓碑复用和缩容：反复插入删除不会让表无限变大，所有存在的键始终能查到
+int test_swiss_resize() {
+    printf("\n" COLOR_YELLOW "[扩容/缩容测试]" COLOR_RESET "\n");
+
+    swisstable_t t;
+    if (kvs_swiss_create(&t) != KVS_OK) return -1;
+    int init_slots = kvs_swiss_slots(&t);
+    int n = init_slots * 64;
+
+    for (int i = 0; i < n; i++) {
+        char key[32];
+        snprintf(key, sizeof(key), "resize_%d", i);
+        if (kvs_swiss_set(&t, key, key) != KVS_OK) {
+            printf(COLOR_RED "✗ 插入失败 (%s)\n" COLOR_RESET, key);
+            kvs_swiss_destroy(&t);
+            return -1;
+        }
+    }
+    int grown = kvs_swiss_slots(&t);
+    for (int i = 0; i < n; i++) {
+        char key[32];
+        char *val = NULL;
+        snprintf(key, sizeof(key), "resize_%d", i);
+        if (kvs_swiss_get(&t, key, &val) != KVS_OK || strcmp(val, key) != 0) {
+            printf(COLOR_RED "✗ 扩容后查询失败 (%s)\n" COLOR_RESET, key);
+            kvs_swiss_destroy(&t);
+            return -1;
+        }
+    }
+    printf(COLOR_GREEN "✓" COLOR_RESET " %d 个键，槽位 %d -> %d\n", n, init_slots, grown);
+
+    // 保持键数不变、不断换新键：墓碑积累到一定程度后原大小重建，槽位数不变
+    for (int i = 0; i < n; i++) {
+        char old_key[32], new_key[32];
+        snprintf(old_key, sizeof(old_key), "resize_%d", i);
+        snprintf(new_key, sizeof(new_key), "churn_%d", i);
+        if (kvs_swiss_del(&t, old_key) != KVS_OK || kvs_swiss_set(&t, new_key, new_key) != KVS_OK) {
+            printf(COLOR_RED "✗ 替换失败 (%s)\n" COLOR_RESET, old_key);
+            kvs_swiss_destroy(&t);
+            return -1;
+        }
+    }
+    if (kvs_swiss_slots(&t) != grown || kvs_swiss_count(&t) != n) {
+        printf(COLOR_RED "✗ 替换后槽位数 %d、键数 %d 不符合预期\n" COLOR_RESET, kvs_swiss_slots(&t), kvs_swiss_count(&t));
+        kvs_swiss_destroy(&t);
+        return -1;
+    }
+    printf(COLOR_GREEN "✓" COLOR_RESET " 替换全部 %d 个键后槽位保持 %d\n", n, grown);
+
+    for (int i = 0; i < n; i++) {
+        char key[32];
+        snprintf(key, sizeof(key), "churn_%d", i);
+        if (kvs_swiss_del(&t, key) != KVS_OK) {
+            printf(COLOR_RED "✗ 删除失败 (%s)\n" COLOR_RESET, key);
+            kvs_swiss_destroy(&t);
+            return -1;
+        }
+    }
+    int shrunk = kvs_swiss_slots(&t);
+    kvs_swiss_destroy(&t);
+    if (grown <= init_slots || shrunk != init_slots) {
+        printf(COLOR_RED "✗ 槽位数不符合预期 (扩容后 %d, 缩容后 %d)\n" COLOR_RESET, grown, shrunk);
+        return -1;
+    }
+    printf(COLOR_GREEN "✓" COLOR_RESET " 删除全部键后槽位缩回 %d\n", shrunk);
+    return 0;
+}
+
 // ========== 性能对比输出 ==========
 void print_performance_comparison(perf_stats_t* stats, int count) {
     print_separator("性能对比报告");
@@ -473,12 +1153,13 @@ int main(int argc, char* argv[]) {
     
     print_separator("KVS 数据结构统一测试");
     printf("\n");
-    printf(COLOR_CYAN "  本测试将对比三种数据结构的性能:\n");
+    printf(COLOR_CYAN "  本测试将对比四种数据结构的性能:\n");
     printf("  • Array   - 数组实现\n");
     printf("  • RBTree  - 红黑树实现\n");
-    printf("  • Hash    - 哈希表实现\n" COLOR_RESET);
+    printf("  • Hash    - 哈希表实现（拉链）\n");
+    printf("  • Swiss   - SwissTable 开放寻址哈希表\n" COLOR_RESET);
     
-    perf_stats_t stats[3];
+    perf_stats_t stats[4];
     int stats_idx = 0;
     
     // 测试 Array
@@ -505,12 +1186,23 @@ int main(int argc, char* argv[]) {
     print_test_header("Hash");
     if (test_hash_basic() == 0) {
         strcpy(stats[stats_idx].name, "Hash");
-        if (test_hash_stress(&stats[stats_idx]) == 0) {
+        if (test_hash_stress(&stats[stats_idx]) == 0 && test_hash_resize() == 0 && test_hash_memory() == 0 &&
+            test_hash_sharded() == 0 && test_hash_threads() == 0 && test_hash_rcu(0) == 0 && test_hash_scan() == 0) {
             printf(COLOR_GREEN "\n✓ Hash 测试完成\n" COLOR_RESET);
             stats_idx++;
         }
     }
     
+    // 测试 SwissTable
+    print_test_header("Swiss");
+    if (test_swiss_basic() == 0) {
+        strcpy(stats[stats_idx].name, "Swiss");
+        if (test_swiss_stress(&stats[stats_idx]) == 0 && test_swiss_resize() == 0 && test_hash_rcu(1) == 0) {
+            printf(COLOR_GREEN "\n✓ Swiss 测试完成\n" COLOR_RESET);
+            stats_idx++;
+        }
+    }
+    
     // 输出性能对比
     print_performance_comparison(stats, stats_idx);
     
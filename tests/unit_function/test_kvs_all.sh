@@ -39,6 +39,8 @@ gcc -o test_kvs_all \
     src/kvs_array.c \
     src/kvs_rbtree.c \
     src/kvs_hash.c \
+    src/kvs_swiss.c \
+    src/qsbr.c \
     -I./include \
     -Wall -Wextra \
     -pthread \
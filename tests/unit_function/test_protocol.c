@@ -2,6 +2,8 @@
 #include "../include/kvs_protocol.h"
 #include "../include/kvs_rbtree.h"
 #include "../include/kvs_hash.h"
+#include "../include/kvs_swiss.h"
+#include "../include/buffer.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -23,6 +25,16 @@ typedef struct {
 
 test_stats_t g_stats = {0, 0, 0};
 
+// ========== 命令执行 ==========
+// 执行命令并把响应拷贝到定长数组，方便直接用 strcmp/strstr 断言
+static void run_command(int cmd, char** tokens, char* response, int size) {
+    buffer_t out;
+    buffer_init(&out);
+    kvs_executor_command(cmd, tokens, &out);
+    snprintf(response, size, "%s", buffer_len(&out) > 0 ? buffer_peek(&out) : "");
+    buffer_free(&out);
+}
+
 // ========== 工具函数 ==========
 void print_separator(const char* title) {
     printf("\n");
@@ -102,6 +114,10 @@ void test_parser() {
         {"HMOD", KVS_CMD_HMOD},
         {"HDEL", KVS_CMD_HDEL},
         {"HEXIST", KVS_CMD_HEXIST},
+        {"HSCAN", KVS_CMD_HSCAN},
+        {"INFO", KVS_CMD_INFO},
+        {"STATS", KVS_CMD_STATS},
+        {"LOGLEVEL", KVS_CMD_LOGLEVEL},
     };
     
     int num_tests = sizeof(tests)/sizeof(tests[0]);
@@ -152,7 +168,7 @@ void test_array_protocol() {
     memset(tokens, 0, sizeof(tokens));
     kvs_tokenizer(msg1, tokens);
     int cmd1 = kvs_parser_command(tokens);
-    kvs_executor_command(cmd1, tokens, response);
+    run_command(cmd1, tokens, response, sizeof(response));
     print_result("SET name Alice", strcmp(response, "OK") == 0);
     
     // 测试GET命令
@@ -160,7 +176,7 @@ void test_array_protocol() {
     memset(tokens, 0, sizeof(tokens));
     kvs_tokenizer(msg2, tokens);
     int cmd2 = kvs_parser_command(tokens);
-    kvs_executor_command(cmd2, tokens, response);
+    run_command(cmd2, tokens, response, sizeof(response));
     print_result("GET name (Alice)", strstr(response, "Alice") != NULL);
     
     // 测试MOD命令
@@ -168,7 +184,7 @@ void test_array_protocol() {
     memset(tokens, 0, sizeof(tokens));
     kvs_tokenizer(msg3, tokens);
     int cmd3 = kvs_parser_command(tokens);
-    kvs_executor_command(cmd3, tokens, response);
+    run_command(cmd3, tokens, response, sizeof(response));
     print_result("MOD name Bob", strcmp(response, "OK") == 0);
     
     // 验证MOD
@@ -176,7 +192,7 @@ void test_array_protocol() {
     memset(tokens, 0, sizeof(tokens));
     kvs_tokenizer(msg4, tokens);
     int cmd4 = kvs_parser_command(tokens);
-    kvs_executor_command(cmd4, tokens, response);
+    run_command(cmd4, tokens, response, sizeof(response));
     print_result("验证MOD (Bob)", strstr(response, "Bob") != NULL);
     
     // 测试EXIST命令
@@ -184,7 +200,7 @@ void test_array_protocol() {
     memset(tokens, 0, sizeof(tokens));
     kvs_tokenizer(msg5, tokens);
     int cmd5 = kvs_parser_command(tokens);
-    kvs_executor_command(cmd5, tokens, response);
+    run_command(cmd5, tokens, response, sizeof(response));
     print_result("EXIST name", strcmp(response, "OK") == 0);
     
     // 测试DEL命令
@@ -192,7 +208,7 @@ void test_array_protocol() {
     memset(tokens, 0, sizeof(tokens));
     kvs_tokenizer(msg6, tokens);
     int cmd6 = kvs_parser_command(tokens);
-    kvs_executor_command(cmd6, tokens, response);
+    run_command(cmd6, tokens, response, sizeof(response));
     print_result("DEL name", strcmp(response, "OK") == 0);
     
     // 验证DEL
@@ -200,7 +216,7 @@ void test_array_protocol() {
     memset(tokens, 0, sizeof(tokens));
     kvs_tokenizer(msg7, tokens);
     int cmd7 = kvs_parser_command(tokens);
-    kvs_executor_command(cmd7, tokens, response);
+    run_command(cmd7, tokens, response, sizeof(response));
     print_result("验证DEL (not found)", strstr(response, "not found") != NULL);
     
     // 清理
@@ -228,7 +244,7 @@ void test_rbtree_protocol() {
     memset(tokens, 0, sizeof(tokens));
     kvs_tokenizer(msg1, tokens);
     int cmd1 = kvs_parser_command(tokens);
-    kvs_executor_command(cmd1, tokens, response);
+    run_command(cmd1, tokens, response, sizeof(response));
     print_result("RSET name Alice", strcmp(response, "OK") == 0);
     
     // 测试RGET命令
@@ -236,7 +252,7 @@ void test_rbtree_protocol() {
     memset(tokens, 0, sizeof(tokens));
     kvs_tokenizer(msg2, tokens);
     int cmd2 = kvs_parser_command(tokens);
-    kvs_executor_command(cmd2, tokens, response);
+    run_command(cmd2, tokens, response, sizeof(response));
     print_result("RGET name (Alice)", strstr(response, "Alice") != NULL);
     
     // 测试RMOD命令
@@ -244,7 +260,7 @@ void test_rbtree_protocol() {
     memset(tokens, 0, sizeof(tokens));
     kvs_tokenizer(msg3, tokens);
     int cmd3 = kvs_parser_command(tokens);
-    kvs_executor_command(cmd3, tokens, response);
+    run_command(cmd3, tokens, response, sizeof(response));
     print_result("RMOD name Bob", strcmp(response, "OK") == 0);
     
     // 验证RMOD
@@ -252,7 +268,7 @@ void test_rbtree_protocol() {
     memset(tokens, 0, sizeof(tokens));
     kvs_tokenizer(msg4, tokens);
     int cmd4 = kvs_parser_command(tokens);
-    kvs_executor_command(cmd4, tokens, response);
+    run_command(cmd4, tokens, response, sizeof(response));
     print_result("验证RMOD (Bob)", strstr(response, "Bob") != NULL);
     
     // 测试REXIST命令
@@ -260,7 +276,7 @@ void test_rbtree_protocol() {
     memset(tokens, 0, sizeof(tokens));
     kvs_tokenizer(msg5, tokens);
     int cmd5 = kvs_parser_command(tokens);
-    kvs_executor_command(cmd5, tokens, response);
+    run_command(cmd5, tokens, response, sizeof(response));
     print_result("REXIST name", strcmp(response, "OK") == 0);
     
     // 测试RDEL命令
@@ -268,7 +284,7 @@ void test_rbtree_protocol() {
     memset(tokens, 0, sizeof(tokens));
     kvs_tokenizer(msg6, tokens);
     int cmd6 = kvs_parser_command(tokens);
-    kvs_executor_command(cmd6, tokens, response);
+    run_command(cmd6, tokens, response, sizeof(response));
     print_result("RDEL name", strcmp(response, "OK") == 0);
     
     // 验证RDEL
@@ -276,7 +292,7 @@ void test_rbtree_protocol() {
     memset(tokens, 0, sizeof(tokens));
     kvs_tokenizer(msg7, tokens);
     int cmd7 = kvs_parser_command(tokens);
-    kvs_executor_command(cmd7, tokens, response);
+    run_command(cmd7, tokens, response, sizeof(response));
     print_result("验证RDEL (not found)", strstr(response, "not found") != NULL);
     
     // 批量测试
@@ -292,7 +308,7 @@ void test_rbtree_protocol() {
         kvs_tokenizer(msg, test_tokens);
         int cmd_id = kvs_parser_command(test_tokens);
         char test_response[512];
-        kvs_executor_command(cmd_id, test_tokens, test_response);
+        run_command(cmd_id, test_tokens, test_response, sizeof(test_response));
         
         if(strncmp(test_response, "OK", 2) == 0){
             success++;
@@ -306,11 +322,72 @@ void test_rbtree_protocol() {
 
 // ========== Hash协议测试 ==========
 
-void test_hash_protocol() {
-    print_test_header("Hash协议集成测试");
+// 执行一条 HSCAN，返回下一个游标（出错返回 -1），键数累加到 *keys
+static long long run_hscan(const char *line, char *response, int size, int *keys) {
+    char msg[256];
+    char *tokens[10] = {0};
+    snprintf(msg, sizeof(msg), "%s", line);
+    kvs_tokenizer(msg, tokens);
+    run_command(kvs_parser_command(tokens), tokens, response, size);
+    if (strncmp(response, "OK ", 3) != 0) {
+        return -1;
+    }
+    char *p = response + 3;
+    long long next = strtoll(p, &p, 10);
+    while (*p == ' ') {
+        (*keys)++;
+        p = strchr(p + 1, ' ');
+        if (p == NULL) break;
+    }
+    return next;
+}
+
+// HSCAN：分多次遍历完批量插入的 100 个键，MATCH 按前缀过滤，参数错误返回 ERROR
+static void test_hash_scan_protocol(int swiss) {
+    char response[4096];
+    char line[64];
+    int keys = 0;
+
+    if (swiss) {
+        print_result("HSCAN 0 (SwissTable 不支持)", run_hscan("HSCAN 0", response, sizeof(response), &keys) < 0 &&
+                     strstr(response, "ERROR") != NULL);
+        return;
+    }
+
+    long long cursor = 0;
+    int calls = 0;
+    do {
+        snprintf(line, sizeof(line), "HSCAN %lld COUNT 7", cursor);
+        cursor = run_hscan(line, response, sizeof(response), &keys);
+        calls++;
+    } while (cursor > 0 && calls < 1000);
+    print_result("HSCAN COUNT 7 遍历全部100个键", cursor == 0 && keys == 100 && calls > 1);
+
+    keys = 0;
+    cursor = 0;
+    do {
+        snprintf(line, sizeof(line), "HSCAN %lld MATCH key_9 COUNT 1000", cursor);
+        cursor = run_hscan(line, response, sizeof(response), &keys);
+    } while (cursor > 0);
+    print_result("HSCAN MATCH key_9 (11个)", cursor == 0 && keys == 11);
+
+    print_result("HSCAN abc (游标非法)", run_hscan("HSCAN abc", response, sizeof(response), &keys) < 0 &&
+                 strstr(response, "ERROR") != NULL);
+    print_result("HSCAN 18446744069414584320 (分片号越界)",
+                 run_hscan("HSCAN 18446744069414584320", response, sizeof(response), &keys) < 0 &&
+                     strstr(response, "ERROR") != NULL);
+    print_result("HSCAN 0 COUNT (缺少参数)", run_hscan("HSCAN 0 COUNT", response, sizeof(response), &keys) < 0 &&
+                 strstr(response, "ERROR") != NULL);
+}
+
+// engine: HSET 系列命令使用的引擎，两种引擎走同一套用例
+void test_hash_protocol(int engine) {
+    int swiss = engine == KVS_HASH_ENGINE_SWISS;
+    print_test_header(swiss ? "Hash协议集成测试 (SwissTable)" : "Hash协议集成测试");
     
     // 初始化哈希表
-    if (kvs_hash_create(global_hash) != KVS_OK) {
+    kvs_hash_engine = engine;
+    if ((swiss ? kvs_swiss_create(global_swiss) : kvs_hash_create(global_hash)) != KVS_OK) {
         printf(COLOR_RED "✗ 初始化Hash失败\n" COLOR_RESET);
         return;
     }
@@ -324,7 +401,7 @@ void test_hash_protocol() {
     memset(tokens, 0, sizeof(tokens));
     kvs_tokenizer(msg1, tokens);
     int cmd1 = kvs_parser_command(tokens);
-    kvs_executor_command(cmd1, tokens, response);
+    run_command(cmd1, tokens, response, sizeof(response));
     print_result("HSET name Alice", strcmp(response, "OK") == 0);
     
     // 测试HGET命令
@@ -332,7 +409,7 @@ void test_hash_protocol() {
     memset(tokens, 0, sizeof(tokens));
     kvs_tokenizer(msg2, tokens);
     int cmd2 = kvs_parser_command(tokens);
-    kvs_executor_command(cmd2, tokens, response);
+    run_command(cmd2, tokens, response, sizeof(response));
     print_result("HGET name (Alice)", strstr(response, "Alice") != NULL);
     
     // 测试HMOD命令
@@ -340,7 +417,7 @@ void test_hash_protocol() {
     memset(tokens, 0, sizeof(tokens));
     kvs_tokenizer(msg3, tokens);
     int cmd3 = kvs_parser_command(tokens);
-    kvs_executor_command(cmd3, tokens, response);
+    run_command(cmd3, tokens, response, sizeof(response));
     print_result("HMOD name Bob", strcmp(response, "OK") == 0);
     
     // 验证HMOD
@@ -348,7 +425,7 @@ void test_hash_protocol() {
     memset(tokens, 0, sizeof(tokens));
     kvs_tokenizer(msg4, tokens);
     int cmd4 = kvs_parser_command(tokens);
-    kvs_executor_command(cmd4, tokens, response);
+    run_command(cmd4, tokens, response, sizeof(response));
     print_result("验证HMOD (Bob)", strstr(response, "Bob") != NULL);
     
     // 测试HEXIST命令
@@ -356,7 +433,7 @@ void test_hash_protocol() {
     memset(tokens, 0, sizeof(tokens));
     kvs_tokenizer(msg5, tokens);
     int cmd5 = kvs_parser_command(tokens);
-    kvs_executor_command(cmd5, tokens, response);
+    run_command(cmd5, tokens, response, sizeof(response));
     print_result("HEXIST name", strcmp(response, "OK") == 0);
     
     // 测试HDEL命令
@@ -364,7 +441,7 @@ void test_hash_protocol() {
     memset(tokens, 0, sizeof(tokens));
     kvs_tokenizer(msg6, tokens);
     int cmd6 = kvs_parser_command(tokens);
-    kvs_executor_command(cmd6, tokens, response);
+    run_command(cmd6, tokens, response, sizeof(response));
     print_result("HDEL name", strcmp(response, "OK") == 0);
     
     // 验证HDEL
@@ -372,7 +449,7 @@ void test_hash_protocol() {
     memset(tokens, 0, sizeof(tokens));
     kvs_tokenizer(msg7, tokens);
     int cmd7 = kvs_parser_command(tokens);
-    kvs_executor_command(cmd7, tokens, response);
+    run_command(cmd7, tokens, response, sizeof(response));
     print_result("验证HDEL (not found)", strstr(response, "not found") != NULL);
     
     // 批量测试
@@ -388,16 +465,23 @@ void test_hash_protocol() {
         kvs_tokenizer(msg, test_tokens);
         int cmd_id = kvs_parser_command(test_tokens);
         char test_response[512];
-        kvs_executor_command(cmd_id, test_tokens, test_response);
+        run_command(cmd_id, test_tokens, test_response, sizeof(test_response));
         
         if(strncmp(test_response, "OK", 2) == 0){
             success++;
         }
     }
     print_result("批量插入100个键值对", success == 100);
+
+    test_hash_scan_protocol(swiss);
     
     // 清理
-    kvs_hash_destroy(global_hash);
+    if (swiss) {
+        kvs_swiss_destroy(global_swiss);
+    } else {
+        kvs_hash_destroy(global_hash);
+    }
+    kvs_hash_engine = KVS_HASH_ENGINE_CHAIN;
 }
 
 // ========== 主函数 ==========
@@ -409,7 +493,7 @@ int main() {
     printf("  • 协议解析器（分词、命令识别）\n");
     printf("  • Array协议集成\n");
     printf("  • RBTree协议集成\n");
-    printf("  • Hash协议集成\n" COLOR_RESET);
+    printf("  • Hash协议集成（拉链 / SwissTable 两种引擎）\n" COLOR_RESET);
     
     // 第一部分：协议基础测试
     print_separator("第一部分：协议基础功能");
@@ -420,7 +504,8 @@ int main() {
     print_separator("第二部分：协议集成测试");
     test_array_protocol();
     test_rbtree_protocol();
-    test_hash_protocol();
+    test_hash_protocol(KVS_HASH_ENGINE_CHAIN);
+    test_hash_protocol(KVS_HASH_ENGINE_SWISS);
     
     // 输出测试总结
     print_separator("测试总结");
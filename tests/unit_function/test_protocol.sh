@@ -36,7 +36,10 @@ gcc -o test_protocol \
     src/kvs_array.c \
     src/kvs_rbtree.c \
     src/kvs_hash.c \
+    src/kvs_swiss.c \
+    src/qsbr.c \
     src/kvs_protocol.c \
+    src/buffer.c \
     -I./include \
     -Wall -Wextra \
     -pthread \